@@ -16,6 +16,7 @@ pushd ..\build
 
 rem call cl /nologo /Zi /O2 /FC ..\disasm\main.cpp /Fedisasm.exe
 rem call cl /nologo /Zi /FC ..\disasm\main.cpp /Fedisasm.exe
+rem call cl /nologo /Zi /O2 /FC ..\disasm\decode_bench.cpp /Fedecode_bench.exe
 call cl /nologo /Zi /FC ..\disasm\main-gui.cpp /Fedisasm-gui.exe /link C:\dev\raylib-4.5.0_win64_msvc16\lib\raylibdll.lib
 
 popd
@@ -0,0 +1,187 @@
+#include "types.h"
+
+#include "mem.h"
+#include "string.h"
+#include "instruction.h"
+#include "sim.h"
+#include "os.h"
+
+#include "mem.cpp"
+#include "string.cpp"
+#include "instruction.cpp"
+#include "sim.cpp"
+#include "os.cpp"
+
+// NOTE(agent): decode throughput of the table decoder (instruction_decode) vs the original switch
+// (instruction_decode_switch). The listings given on the command line are concatenated over and
+// over until they fill most of the simulator's memory, then both decoders are checked against each
+// other and timed decoding all of it.
+
+#define BENCH_CODE_SIZE (MB(1) - 16)
+#define BENCH_PASS_COUNT 32
+
+typedef instruction_t decode_func_t(simulator_t *sim, u32 offset);
+
+struct bench_result_t {
+  u64 best_time;
+  u64 instruction_count;
+  u64 checksum;
+};
+
+static b32 operand_equal(operand_t a, operand_t b) {
+  b32 result = a.kind == b.kind;
+  if (result) {
+    switch (a.kind) {
+    case OPERAND_KIND_IMMEDIATE: result = a.immediate == b.immediate; break;
+    case OPERAND_KIND_REGISTER: result = a.reg == b.reg; break;
+    case OPERAND_KIND_ADDRESS: {
+      result = (a.address.register_count == b.address.register_count) &&
+               (a.address.registers[0] == b.address.registers[0]) &&
+               (a.address.registers[1] == b.address.registers[1]) &&
+               (a.address.offset == b.address.offset);
+    } break;
+
+    case OPERAND_KIND_NONE:
+    case OPERAND_KIND_COUNT:
+      break;
+    }
+  }
+  return result;
+}
+
+static b32 instruction_equal(instruction_t a, instruction_t b) {
+  b32 result = (a.ip == b.ip) && (a.bytes_count == b.bytes_count) && (a.opcode == b.opcode) &&
+               (a.flags == b.flags) && operand_equal(a.dest, b.dest) && operand_equal(a.source, b.source);
+  return result;
+}
+
+// NOTE(agent): only files the switch decodes without an error are used, since the error path formats
+// a message and would swamp the decode time
+static b32 decodes_cleanly(simulator_t *sim) {
+  u32 ip = 0;
+  while (ip < sim->code_end && !sim->error.length) {
+    instruction_t instruction = instruction_decode_switch(sim, ip);
+    ip += instruction.bytes_count;
+  }
+  return sim->error.length == 0;
+}
+
+static bench_result_t bench_decoder(simulator_t *sim, decode_func_t *decode) {
+  bench_result_t result = {};
+  result.best_time = (u64)-1;
+
+  for (u32 pass = 0; pass < BENCH_PASS_COUNT; pass += 1) {
+    u64 instruction_count = 0;
+    u64 checksum = 0;
+
+    u64 start = os_timer_read();
+    u32 ip = 0;
+    while (ip < sim->code_end) {
+      instruction_t instruction = decode(sim, ip);
+      checksum += instruction.opcode + instruction.source.immediate;
+      instruction_count += 1;
+      ip += instruction.bytes_count;
+    }
+    u64 elapsed = os_timer_read() - start;
+
+    if (elapsed < result.best_time) {
+      result.best_time = elapsed;
+    }
+    result.instruction_count = instruction_count;
+    result.checksum = checksum;
+  }
+
+  return result;
+}
+
+static void print_bench_result(const char *name, bench_result_t result, u64 byte_count, u64 freq) {
+  double seconds = (double)result.best_time / (double)freq;
+  fprintf(stdout, "%-8s %10.3f ms  %8.2f mb/s  %8.2f M instructions/s  (checksum %llx)\n", name, seconds * 1000.0,
+          ((double)byte_count / (1024.0 * 1024.0)) / seconds, ((double)result.instruction_count / 1000000.0) / seconds,
+          result.checksum);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "Usage: %s <listing> [listing ...]\n", argv[0]);
+    return 1;
+  }
+
+  init_register_map();
+  init_decode_table();
+
+  simulator_t sim = {};
+  sim.arena = arena_create();
+  sim.memory = PUSH_ARRAY(sim.arena, u8, MB(1));
+
+  arena_t *arena = arena_create();
+  u8 *code = PUSH_ARRAY(arena, u8, BENCH_CODE_SIZE);
+  u32 code_size = 0;
+
+  // NOTE(agent): gather the listings that decode cleanly
+  string_list_t listings = {};
+  for (s32 i = 1; i < argc; i += 1) {
+    string_t obj = read_entire_file(arena, argv[i]);
+    if (!obj.length) {
+      fprintf(stderr, "Failed to open %s\n", argv[i]);
+      continue;
+    }
+
+    sim.error.length = 0;
+    sim_load(&sim, obj);
+    sim.code_end = obj.length;
+    if (decodes_cleanly(&sim)) {
+      string_list_push(arena, &listings, obj);
+    } else {
+      fprintf(stderr, "Skipping %s: %.*s\n", argv[i], STRING_FMT(sim.error));
+    }
+  }
+
+  if (!listings.total_length) {
+    fprintf(stderr, "Nothing to decode\n");
+    return 1;
+  }
+
+  for (;;) {
+    b32 added = 0;
+    for (string_list_node_t *node = listings.first; node; node = node->next) {
+      string_t obj = node->string;
+      if (code_size + obj.length <= BENCH_CODE_SIZE) {
+        memcpy(code + code_size, obj.data, obj.length);
+        code_size += obj.length;
+        added = 1;
+      }
+    }
+    if (!added) break;
+  }
+
+  sim.error.length = 0;
+  sim_load(&sim, { code, code_size });
+  sim.code_end = code_size;
+
+  // NOTE(agent): both decoders have to agree on every instruction before their times mean anything
+  u64 instruction_count = 0;
+  for (u32 ip = 0; ip < sim.code_end;) {
+    instruction_t a = instruction_decode_switch(&sim, ip);
+    instruction_t b = instruction_decode(&sim, ip);
+    if (!instruction_equal(a, b)) {
+      fprintf(stderr, "Decoders disagree at 0x%x (first byte 0x%02x)\n", ip, sim.memory[ip]);
+      return 1;
+    }
+    instruction_count += 1;
+    ip += a.bytes_count;
+  }
+
+  fprintf(stdout, "%u listings, %u bytes, %llu instructions, best of %u passes\n", (u32)listings.node_count,
+          code_size, instruction_count, BENCH_PASS_COUNT);
+
+  u64 freq = os_timer_frequency();
+  bench_result_t switch_result = bench_decoder(&sim, instruction_decode_switch);
+  bench_result_t table_result = bench_decoder(&sim, instruction_decode);
+
+  print_bench_result("switch", switch_result, code_size, freq);
+  print_bench_result("table", table_result, code_size, freq);
+  fprintf(stdout, "speedup  %.2fx\n", (double)switch_result.best_time / (double)table_result.best_time);
+
+  return 0;
+}
@@ -6,11 +6,23 @@
 
 #include <math.h>
 
+// NOTE(agent): formatted once per instruction when it's decoded, and only again if its bytes change
+struct ui_line_t {
+  u8 *ip;
+  u8 bytes_count;
+  u8 bytes[INSTRUCTION_MAX_BYTE_COUNT];
+
+  // NOTE(agent): +1 for the terminator, since raylib wants a c string
+  char text[PRINT_INSTRUCTION_MAX + 1];
+};
+
 struct ui_t {
   string_t filename;
 
   instruction_t *instructions;
+  ui_line_t *lines;
   u32 instruction_count;
+  u32 instruction_capacity;
 
   s8 max_instruction_width;
 
@@ -20,10 +32,32 @@ struct ui_t {
 
   u64 load_file_index;
 
+  // NOTE(agent): one bit per address, so checking for a breakpoint costs the same however many there are
+  u8 *breakpoints;
+
+  b32 running;
+  double run_rate; // instructions per second during the last run slice
+
   arena_t *frame_arena;
   arena_t *arena;
 };
 
+#define BREAKPOINTS_SIZE (MB(1) / 8)
+
+static b32 ui_breakpoint_get(ui_t *ui, u32 address) {
+  b32 result = 0;
+  if (ui->breakpoints && (address < MB(1))) {
+    result = ui->breakpoints[address >> 3] & (1 << (address & 7));
+  }
+  return result;
+}
+
+static void ui_breakpoint_toggle(ui_t *ui, u32 address) {
+  if (ui->breakpoints && (address < MB(1))) {
+    ui->breakpoints[address >> 3] ^= (1 << (address & 7));
+  }
+}
+
 
 static Font font;
 
@@ -114,16 +148,61 @@ static Rectangle rectcut_cut(RectCut cut, float f) {
     return *cut.rect;
 }
 
+static b32 ui_line_changed(ui_line_t *line, instruction_t instruction) {
+  b32 result = (line->ip != instruction.ip) || (line->bytes_count != instruction.bytes_count) ||
+               (memcmp(line->bytes, instruction.ip, line->bytes_count) != 0);
+  return result;
+}
+
+static void ui_line_set(ui_line_t *line, instruction_t instruction) {
+  u8 bytes_count = instruction.bytes_count;
+  if (bytes_count > INSTRUCTION_MAX_BYTE_COUNT) {
+    bytes_count = INSTRUCTION_MAX_BYTE_COUNT;
+  }
+
+  line->ip = instruction.ip;
+  line->bytes_count = bytes_count;
+  memcpy(line->bytes, instruction.ip, bytes_count);
+
+  print_buffer_t buffer = print_buffer_create((u8 *)line->text, PRINT_INSTRUCTION_MAX, 0);
+  print_instruction(&buffer, instruction);
+  line->text[buffer.length] = 0;
+}
+
+// NOTE(agent): instructions are decoded front to back, so they're sorted by ip
+static s32 ui_find_instruction(ui_t *ui, u8 *ip) {
+  s32 result = -1;
+
+  s32 lo = 0;
+  s32 hi = ui->instruction_count;
+  while (lo < hi) {
+    s32 mid = lo + (hi - lo) / 2;
+    u8 *mid_ip = ui->instructions[mid].ip;
+    if (mid_ip < ip) {
+      lo = mid + 1;
+    } else if (mid_ip > ip) {
+      hi = mid;
+    } else {
+      result = mid;
+      break;
+    }
+  }
+
+  return result;
+}
+
 static void draw_instructions(Rectangle rect, simulator_t *sim, ui_t *ui) {
   instruction_t *instructions = ui->instructions;
   u32 instruction_count = ui->instruction_count; 
 
-  GuiPanel(rect, TextFormat("%.*s", STRING_FMT(ui->filename)));
+  if (ui->running) {
+    GuiPanel(rect, TextFormat("%.*s - running, %.1fM instructions/s", STRING_FMT(ui->filename), ui->run_rate / 1000000.0));
+  } else {
+    GuiPanel(rect, TextFormat("%.*s", STRING_FMT(ui->filename)));
+  }
 
   float instructions_height = (instruction_count * line_height) * 1.25f;
 
-  // TODO: scroll active instruction into view
-
   static Vector2 scroll;
   static Rectangle scroll_rec = { rect.x, rect.y + RAYGUI_WINDOWBOX_STATUSBAR_HEIGHT, rect.width, rect.height - RAYGUI_WINDOWBOX_STATUSBAR_HEIGHT };
   static Rectangle scroll_content_rec = { 0, 0, scroll_rec.width - SCROLLBAR_WIDTH, instructions_height };
@@ -134,17 +213,55 @@ static void draw_instructions(Rectangle rect, simulator_t *sim, ui_t *ui) {
   }
 
   Rectangle view = GuiScrollPanel(scroll_rec, NULL, scroll_content_rec, &scroll);
+
+  float rows_y = scroll_rec.y + TEXT_PADDING;
+
+  // NOTE(agent): only follow ip when it moves, so the list can still be scrolled by hand while stopped
+  static u8 *followed_ip;
+  u8 *current_ip = sim->memory + sim->ip;
+  if (current_ip != followed_ip) {
+    followed_ip = current_ip;
+
+    s32 current_index = ui_find_instruction(ui, current_ip);
+    if (current_index >= 0) {
+      float row_y = rows_y + scroll.y + (current_index * line_height);
+      if (row_y < view.y) {
+        scroll.y += view.y - row_y;
+      } else if ((row_y + line_height) > (view.y + view.height)) {
+        scroll.y -= (row_y + line_height) - (view.y + view.height);
+      }
+      if (scroll.y > 0) {
+        scroll.y = 0;
+      }
+    }
+  }
+
   BeginScissorMode(view.x, view.y, view.width, view.height);
 
+  // NOTE(agent): only the rows inside the view are drawn, so frame time doesn't depend on program size
+  s32 first = (s32)((view.y - (rows_y + scroll.y)) / line_height);
+  if (first < 0) {
+    first = 0;
+  }
+  s32 last = first + (s32)(view.height / line_height) + 2;
+  if (last > (s32)instruction_count) {
+    last = instruction_count;
+  }
+
   int text_x = scroll_rec.x + TEXT_PADDING;
-  int text_y = scroll_rec.y + TEXT_PADDING + scroll.y;
+  int text_y = rows_y + scroll.y + (first * line_height);
 
   int address_width = GetTextWidth("000000");
   int byte_width = GetTextWidth("00");
 
-  for (s32 i = 0; i < instruction_count; i += 1) {
+  // NOTE(agent): clicking an address toggles a breakpoint on it
+  Vector2 mouse = GetMousePosition();
+  b32 clicked = IsMouseButtonPressed(MOUSE_BUTTON_LEFT) && CheckCollisionPointRec(mouse, view);
+
+  for (s32 i = first; i < last; i += 1) {
     instruction_t instruction = instructions[i];
-    b32 current = (sim->memory + sim->ip) == instruction.ip;
+    ui_line_t *line = &ui->lines[i];
+    b32 current = current_ip == instruction.ip;
 
     if (current) {
       Color color = GetColor(GuiGetStyle(DEFAULT, BASE_COLOR_PRESSED));
@@ -155,8 +272,18 @@ static void draw_instructions(Rectangle rect, simulator_t *sim, ui_t *ui) {
     int x = text_x;
 
     { // address
+      u32 address = (u32)(instruction.ip - sim->memory);
+
+      Rectangle address_rect = { (float)x, (float)(text_y - (TEXT_INNER_PADDING / 2)), (float)address_width, line_height };
+      if (clicked && CheckCollisionPointRec(mouse, address_rect)) {
+        ui_breakpoint_toggle(ui, address);
+      }
+
       Color color = current ? GetColor(GuiGetStyle(DEFAULT, TEXT_COLOR_PRESSED)) : Fade(GetColor(GuiGetStyle(DEFAULT, TEXT_COLOR_NORMAL)), 0.5);
-      const char *text = TextFormat("%06x", instruction.ip - sim->memory);
+      if (ui_breakpoint_get(ui, address)) {
+        color = RED;
+      }
+      const char *text = TextFormat("%06x", address);
       Text(text, x, text_y, color);
       x += address_width + TEXT_PADDING;
     }
@@ -170,10 +297,8 @@ static void draw_instructions(Rectangle rect, simulator_t *sim, ui_t *ui) {
       x = text_x + address_width + ((ui->max_instruction_width + 1) * byte_width * 1.25);
     }
     { // decoded instruction
-      string_t s = print_instruction(ui->frame_arena, sim, instruction);
-      const char *text = TextFormat("%.*s", STRING_FMT(s));
       GuiControlProperty c = current ? TEXT_COLOR_PRESSED : TEXT_COLOR_NORMAL;
-      Text(text, x, text_y, GetColor(GuiGetStyle(DEFAULT, c)));
+      Text(line->text, x, text_y, GetColor(GuiGetStyle(DEFAULT, c)));
     }
 
     text_y += line_height;
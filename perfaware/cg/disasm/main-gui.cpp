@@ -30,9 +30,17 @@ static void ui_decode_instructions(simulator_t *sim, ui_t *ui, u32 offset) {
   for (;;) {
     // TODO: more explicit way to define end of program?
     if (ip >= sim->code_end) break;
+    if (instruction_count >= ui->instruction_capacity) break;
 
     instruction_t instruction = instruction_decode(sim, ip);
 
+    // NOTE(agent): this runs again after every step in case the code was written to, so the text is only
+    // formatted when the instruction actually changed
+    ui_line_t *line = &ui->lines[instruction_count];
+    if (ui_line_changed(line, instruction)) {
+      ui_line_set(line, instruction);
+    }
+
     ui->instructions[instruction_count++] = instruction;
 
     ip += instruction.bytes_count;
@@ -46,12 +54,51 @@ static void ui_decode_instructions(simulator_t *sim, ui_t *ui, u32 offset) {
   ui->max_instruction_width = max_instruction_width;
 }
 
+// NOTE(agent): while running, the simulator gets this much of every frame and the screen is only redrawn
+// in between, so the frame rate doesn't limit how fast the program runs
+#define RUN_SLICE_SECONDS 0.008
+#define RUN_STEPS_PER_TIME_CHECK 4096
+
+static void ui_run_slice(simulator_t *sim, ui_t *ui) {
+  double start = GetTime();
+  double end = start + RUN_SLICE_SECONDS;
+
+  u64 steps = 0;
+  while (ui->running) {
+    for (u32 i = 0; i < RUN_STEPS_PER_TIME_CHECK; i += 1) {
+      if (sim->error.length || (sim->ip >= sim->code_end) || ui_breakpoint_get(ui, sim->ip)) {
+        ui->running = 0;
+        break;
+      }
+
+      sim_step(sim);
+      steps += 1;
+    }
+
+    if (GetTime() >= end) break;
+  }
+
+  double elapsed = GetTime() - start;
+  if (elapsed > 0) {
+    ui->run_rate = steps / elapsed;
+  }
+
+  // NOTE(agent): once per slice rather than per step, in case the code was written to
+  ui_decode_instructions(sim, ui, 0);
+}
+
 static void ui_load_file(simulator_t *sim, ui_t *ui, char *file) {
   sim_reset(sim);
 
   arena_reset(ui->arena);
 
-  ui->instructions = PUSH_ARRAY(ui->arena, instruction_t, 1000);
+  ui->running = 0;
+  ui->breakpoints = PUSH_ARRAY(ui->arena, u8, BREAKPOINTS_SIZE);
+
+  ui->instructions = 0;
+  ui->lines = 0;
+  ui->instruction_count = 0;
+  ui->instruction_capacity = 0;
 
   string_list_t parts = string_split(ui->frame_arena, string_cstring(ui->frame_arena, file), '/');
   string_t filename = parts.last->string;
@@ -60,6 +107,11 @@ static void ui_load_file(simulator_t *sim, ui_t *ui, char *file) {
   if (obj.length) {
     sim_load(sim, obj);
 
+    // NOTE(agent): every instruction is at least one byte, so there can't be more than this
+    ui->instruction_capacity = sim->code_end;
+    ui->instructions = PUSH_ARRAY(ui->arena, instruction_t, ui->instruction_capacity);
+    ui->lines = PUSH_ARRAY(ui->arena, ui_line_t, ui->instruction_capacity);
+
     ui->filename = filename;
 
     ui_decode_instructions(sim, ui, 0);
@@ -71,9 +123,6 @@ static void ui_load_file(simulator_t *sim, ui_t *ui, char *file) {
 }
 
 static void ui_step(simulator_t *sim, ui_t *ui, b32 verbose) {
-  arena_temp_t temp = arena_temp_begin(ui->frame_arena);
-  arena_t *arena = temp.arena;
-
   instruction_t instruction = instruction_decode(sim, sim->ip);
   if (!sim->error.length) {
     u32 ip_before = sim->ip;
@@ -87,10 +136,11 @@ static void ui_step(simulator_t *sim, ui_t *ui, b32 verbose) {
     instruction_simulate(sim, instruction);
 
     if (verbose) {
-      string_list_t sb = {};
-      string_t a = print_instruction(arena, sim, instruction); 
-      string_list_push(arena, &sb, a);
-      string_list_push(arena, &sb, STRING_LIT(" ; "));
+      u8 line[256];
+      print_buffer_t out = print_buffer_create(line, sizeof(line), stdout);
+
+      print_instruction(&out, instruction);
+      print_string(&out, STRING_LIT(" ; "));
 
       register_t registers[] = { REGISTER_AX, REGISTER_BX, REGISTER_CX, REGISTER_DX, REGISTER_SP, REGISTER_BP, REGISTER_SI, REGISTER_DI };
       for (u32 i = 0; i < 8; i += 1) {
@@ -98,29 +148,39 @@ static void ui_step(simulator_t *sim, ui_t *ui, b32 verbose) {
         u16 after = sim->registers[i];
         if (before != after) {
           register_t reg = registers[i];
-          string_list_pushf(arena, &sb, "%.*s:0x%x->0x%x ", STRING_FMT(register_names[reg]), before, after);
+          print_string(&out, register_names[reg]);
+          print_string(&out, STRING_LIT(":0x"));
+          print_hex(&out, before);
+          print_string(&out, STRING_LIT("->0x"));
+          print_hex(&out, after);
+          print_char(&out, ' ');
         }
       }
 
-      string_list_pushf(arena, &sb, "ip:0x%x->0x%x ", ip_before, sim->ip);
+      print_string(&out, STRING_LIT("ip:0x"));
+      print_hex(&out, ip_before);
+      print_string(&out, STRING_LIT("->0x"));
+      print_hex(&out, sim->ip);
+      print_char(&out, ' ');
 
       if (flags_before != sim->flags) {
-        string_t before = print_flags(arena, flags_before);
-        string_t after = print_flags(arena, sim->flags);
-        string_list_pushf(arena, &sb, "flags:%.*s->%.*s ", STRING_FMT(before), STRING_FMT(after));
+        print_string(&out, STRING_LIT("flags:"));
+        print_flags(&out, flags_before);
+        print_string(&out, STRING_LIT("->"));
+        print_flags(&out, sim->flags);
+        print_char(&out, ' ');
       }
 
-      string_t text = string_list_join(arena, &sb, STRING_LIT(""));
-      printf("%.*s\n", STRING_FMT(text));
+      print_char(&out, '\n');
+      print_flush(&out);
     }
   }
-
-  arena_temp_end(temp);
 }
 
 
 int main(void) {
   init_register_map();
+  init_decode_table();
 
   ui_t ui            = {};
   ui.arena           = arena_create();
@@ -141,42 +201,37 @@ int main(void) {
   SetTargetFPS(144);
 
   b32 should_draw = 1;
-  b32 running = 0;
   while (!WindowShouldClose()) {
     arena_reset(ui.frame_arena);
 
     // input + update
-    if ((running || IsKeyPressed(KEY_F10)) && (sim.error.length == 0)) {
-      if (sim.ip >= sim.code_end) {
-        if (!running) {
-          sim_reset(&sim);
-        }
-        running = 0;
+    if (IsKeyPressed(KEY_F5)) {
+      if (ui.running) {
+        ui.running = 0;
       } else {
-        u32 steps = running ? 10000 : 1;
-
-        while (steps--) {
+        // NOTE(agent): start over once the program has finished, otherwise continue from where it stopped,
+        // stepping first so a breakpoint there doesn't stop it again right away
+        if (sim.error.length || (sim.ip >= sim.code_end)) {
+          sim_reset(&sim);
+        } else {
           ui_step(&sim, &ui, 0);
-
-          if (sim.error.length || (sim.ip >= sim.code_end)) {
-            running = 0;
-            break;
-          }
-
-          ui_decode_instructions(&sim, &ui, 0);
         }
+        ui.running = 1;
       }
-
-      should_draw = 1;
-    } else if (IsKeyPressed(KEY_F5)) {
-      if (running) {
-        running = 0;
-      } else {
+    } else if (IsKeyPressed(KEY_F10) && !ui.running && (sim.error.length == 0)) {
+      if (sim.ip >= sim.code_end) {
         sim_reset(&sim);
-        running = 1;
+      } else {
+        ui_step(&sim, &ui, 0);
+        ui_decode_instructions(&sim, &ui, 0);
       }
     }
 
+    if (ui.running) {
+      ui_run_slice(&sim, &ui);
+      should_draw = 1;
+    }
+
     if (IsFileDropped()) {
       FilePathList files = LoadDroppedFiles();
       if (files.count) {
@@ -62,6 +62,7 @@ int main(int argc, char **argv) {
   }
 
   init_register_map();
+  init_decode_table();
 
   simulator_t sim = {};
   sim.arena = arena_create();
@@ -81,45 +82,42 @@ int main(int argc, char **argv) {
     arena_temp_end(temp);
   }
 
+  // NOTE(agent): lines are formatted straight into this and written out in big chunks
+  print_buffer_t out = print_buffer_create(PUSH_ARRAY(sim.arena, u8, KB(64)), KB(64), stdout);
+
   u32 total_clocks = 0;
   u32 ip = 0;
   for (;;) {
-    if ((sim.memory + ip) >= sim.code_end) break;
+    if (ip >= sim.code_end) break;
 
     instruction_t instruction = instruction_decode(&sim, ip);
     if (instruction.opcode == OP_CODE_INT) break;
 
     u32 clocks = instruction_estimate_clocks(&sim, instruction);
 
-    arena_temp_t temp = arena_temp_begin(sim.arena);
-    arena_t *arena = temp.arena;
-
     total_clocks += clocks;
 
-    string_list_t sb = {};
-    string_list_push(arena, &sb, print_instruction(arena, &sim, instruction));
-    string_list_push(arena, &sb, STRING_LIT(" ; "));
-
-    string_list_pushf(arena, &sb, " Clocks: +%d = %d ", clocks, total_clocks);
-
-    string_list_push(arena, &sb, STRING_LIT("| "));
+    print_instruction(&out, instruction);
+    print_string(&out, STRING_LIT(" ;  Clocks: +"));
+    print_u32(&out, clocks);
+    print_string(&out, STRING_LIT(" = "));
+    print_u32(&out, total_clocks);
+    print_string(&out, STRING_LIT(" | \n"));
 
     // TODO: print registers
     // TODO: print ip
 
     ip += instruction.bytes_count;
 
-    string_t s = string_list_join(arena, &sb, STRING_LIT(""));
-    printf("%.*s\n", STRING_FMT(s));
-
-    arena_temp_end(temp);
-
     if (sim.error.length) {
+      print_flush(&out);
       printf(";;; %.*s\n", STRING_FMT(sim.error));
       break;
     }
   }
 
+  print_flush(&out);
+
   return sim.error.length;
 }
 
@@ -1,47 +1,158 @@
 #include "mem.h"
+#include "os.h"
 
-#define DEFAULT_ARENA_SIZE MB(4)
+#define ARENA_DEFAULT_RESERVE_SIZE       GB((u64)64)
+#define ARENA_DEFAULT_COMMIT_SIZE        KB(64)
+#define ARENA_DEFAULT_ALIGN              8
+#define ARENA_DEFAULT_DECOMMIT_THRESHOLD MB(64)
+
+static b32 is_pow2(u64 x) {
+  return x && !(x & (x - 1));
+}
+
+static u64 align_pow2(u64 x, u64 align) {
+  return (x + align - 1) & ~(align - 1);
+}
+
+// NOTE(agent): commit_size is only a multiple of the page size, not necessarily a power of two
+static u64 align_up(u64 x, u64 granularity) {
+  return ((x + granularity - 1) / granularity) * granularity;
+}
+
+arena_params_t arena_default_params(void) {
+  arena_params_t result = {};
+  result.reserve_size = ARENA_DEFAULT_RESERVE_SIZE;
+  result.commit_size = ARENA_DEFAULT_COMMIT_SIZE;
+  result.align = ARENA_DEFAULT_ALIGN;
+  result.decommit_threshold = ARENA_DEFAULT_DECOMMIT_THRESHOLD;
+  return result;
+}
 
 arena_t *arena_create(void) {
-  arena_t *result = 0;
+  return arena_create(arena_default_params());
+}
 
-  u8 *data = (u8 *)malloc(sizeof(arena_t) + DEFAULT_ARENA_SIZE);
+arena_t *arena_create(arena_params_t params) {
+  arena_t *result = 0;
 
-  result = (arena_t *)data;
-  // TODO: pow2 align
+  assert(is_pow2(params.align) && "Arena alignment must be a power of two");
+
+  u64 page_size = os_page_size();
+  u64 reserve = align_pow2(params.reserve_size, page_size);
+  u64 commit_size = align_pow2(params.commit_size ? params.commit_size : page_size, page_size);
+  if (commit_size > reserve) {
+    commit_size = reserve;
+  }
+
+  u8 *base = 0;
+  u64 commit = 0;
+  b32 large_pages = 0;
+
+  if (params.large_pages) {
+    u64 large_page_size = os_large_page_size();
+    if (large_page_size) {
+      u64 large_reserve = align_pow2(reserve, large_page_size);
+      if (large_reserve <= ARENA_MAX_LARGE_PAGE_RESERVE) {
+        base = (u8 *)os_memory_alloc_large(large_reserve);
+        if (base) {
+          reserve = large_reserve;
+          commit = large_reserve;
+          large_pages = 1;
+        }
+      }
+    }
+  }
+
+  if (!base) {
+    base = (u8 *)os_memory_reserve(reserve);
+    if (base) {
+      if (os_memory_commit(base, commit_size)) {
+        commit = commit_size;
+      } else {
+        os_memory_release(base);
+        base = 0;
+      }
+    }
+  }
+
+  assert(base != 0 && "Arena failed to reserve");
+
+  result = (arena_t *)base;
   result->pos = sizeof(*result);
-  result->cap = DEFAULT_ARENA_SIZE;
+  result->commit = commit;
+  result->reserve = reserve;
+  result->align = params.align;
+  result->commit_size = commit_size;
+  result->decommit_threshold = params.decommit_threshold;
+  result->large_pages = large_pages;
 
   return result;
 }
 
+void arena_release(arena_t *arena) {
+  os_memory_release(arena);
+}
+
 void arena_reset(arena_t *arena) {
-  arena->pos = sizeof(*arena);
+  arena_pop_to(arena, 0);
 }
 
-void *arena_push(arena_t *arena, u64 size) {
+void *arena_push_aligned(arena_t *arena, u64 size, u64 align) {
   void *result = 0;
 
-  assert(arena->pos + size <= arena->cap && "Arena out of memory");
+  assert(is_pow2(align) && "Arena alignment must be a power of two");
+
+  u64 start = align_pow2(arena->pos, align);
+  u64 end = start + size;
+
+  if (end <= arena->reserve) {
+    if (end > arena->commit) {
+      u64 commit = align_up(end, arena->commit_size);
+      if (commit > arena->reserve) {
+        commit = arena->reserve;
+      }
 
-  result = (u8 *)arena + arena->pos;
-  arena->pos += size;
+      if (os_memory_commit((u8 *)arena + arena->commit, commit - arena->commit)) {
+        arena->commit = commit;
+      }
+    }
 
-  assert(result != 0 && "Arena failed to allocate");
+    if (end <= arena->commit) {
+      result = (u8 *)arena + start;
+      arena->pos = end;
+    }
+  }
+
+  assert(result != 0 && "Arena out of memory");
 
   return result;
 }
 
+void *arena_push(arena_t *arena, u64 size) {
+  return arena_push_aligned(arena, size, arena->align);
+}
+
 void *arena_push_zero(arena_t *arena, u64 size) {
   void *result = arena_push(arena, size);
   memset(result, 0, size);
   return result;
 }
 
+// NOTE(agent): pos is what arena->pos was at some point, so it already counts the arena header
 void arena_pop_to(arena_t *arena, u64 pos) {
-  // TODO: pow2 align
-  arena->pos = sizeof(*arena) + pos;
-  // TODO: handle decommit
+  if (pos < sizeof(*arena)) {
+    pos = sizeof(*arena);
+  }
+  assert(pos <= arena->pos && "Arena popped past its end");
+  arena->pos = pos;
+
+  if (!arena->large_pages) {
+    u64 keep = align_up(pos, arena->commit_size);
+    if (arena->commit > keep && arena->commit - keep >= arena->decommit_threshold) {
+      os_memory_decommit((u8 *)arena + keep, arena->commit - keep);
+      arena->commit = keep;
+    }
+  }
 }
 
 arena_temp_t arena_temp_begin(arena_t *arena) {
@@ -54,4 +165,3 @@ arena_temp_t arena_temp_begin(arena_t *arena) {
 void arena_temp_end(arena_temp_t temp) {
   arena_pop_to(temp.arena, temp.pos);
 }
-
@@ -5,10 +5,40 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 
+// NOTE(agent): the most a large page arena will commit up front, see arena_params_t::large_pages
+#define ARENA_MAX_LARGE_PAGE_RESERVE MB((u64)512)
+
+// NOTE(agent): an arena reserves its whole address range up front and commits it commit_size bytes
+// at a time as it grows. pos, commit and reserve are all offsets from the arena itself, which
+// lives at the start of its own range.
 struct arena_t {
   u64 pos;
-  u64 cap;
-  // TODO: handle growing reserve/commit
+  u64 commit;
+  u64 reserve;
+
+  u64 align;
+  u64 commit_size;
+  u64 decommit_threshold;
+
+  b32 large_pages;
+};
+
+struct arena_params_t {
+  u64 reserve_size;
+  u64 commit_size;
+
+  // NOTE(agent): default alignment of pushes, has to be a power of two
+  u64 align;
+
+  // NOTE(agent): popping only gives memory back to the OS once at least this much committed memory
+  // is left unused, so arenas that are reset every frame don't commit and decommit constantly
+  u64 decommit_threshold;
+
+  // NOTE(agent): large pages have to be committed when they're reserved, so the whole reserve_size is
+  // committed up front and never decommitted. Only used when reserve_size (rounded up to
+  // the large page size) is at most ARENA_MAX_LARGE_PAGE_RESERVE, so the default 64GB reserve never
+  // gets them. Falls back to normal pages otherwise, or when they're unavailable.
+  b32 large_pages;
 };
 
 struct arena_temp_t {
@@ -18,10 +48,15 @@ struct arena_temp_t {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+arena_params_t arena_default_params(void);
+
 arena_t *arena_create(void);
+arena_t *arena_create(arena_params_t params);
+void     arena_release(arena_t *arena);
 void     arena_reset(arena_t *arena);
 
 void    *arena_push(arena_t *arena, u64 size);
+void    *arena_push_aligned(arena_t *arena, u64 size, u64 align);
 void    *arena_push_zero(arena_t *arena, u64 size);
 void     arena_pop_to(arena_t *arena, u64 pos);
 
@@ -2,6 +2,24 @@
 
 #include "mem.h"
 
+#ifdef RAYLIB_H
+// NOTE(agent): raylib's names clash with windows.h, so declare the few kernel32 calls the arena needs
+// by hand
+extern "C" {
+__declspec(dllimport) void *__stdcall VirtualAlloc(void *address, size_t size, unsigned long type, unsigned long protect);
+__declspec(dllimport) int __stdcall VirtualFree(void *address, size_t size, unsigned long type);
+}
+
+#define MEM_COMMIT      0x00001000
+#define MEM_RESERVE     0x00002000
+#define MEM_DECOMMIT    0x00004000
+#define MEM_RELEASE     0x00008000
+#define MEM_LARGE_PAGES 0x20000000
+#define PAGE_READWRITE  0x04
+#else
+#pragma comment (lib, "advapi32.lib")
+#endif
+
 string_t read_entire_file(arena_t *arena, char *filename) {
   string_t result = {};
 
@@ -37,3 +55,93 @@ string_t read_entire_file(arena_t *arena, char *filename) {
 
   return result;
 }
+
+u64 os_timer_frequency(void) {
+#ifdef RAYLIB_H
+  // NOTE(agent): raylib only gives us seconds as a double, so count microseconds
+  return 1000000;
+#else
+  LARGE_INTEGER frequency;
+  QueryPerformanceFrequency(&frequency);
+  return frequency.QuadPart;
+#endif
+}
+
+u64 os_timer_read(void) {
+#ifdef RAYLIB_H
+  return (u64)(GetTime() * 1000000.0);
+#else
+  LARGE_INTEGER value;
+  QueryPerformanceCounter(&value);
+  return value.QuadPart;
+#endif
+}
+
+u64 os_page_size(void) {
+#ifdef RAYLIB_H
+  // NOTE(agent): always 4k on x64 windows, and GetSystemInfo would need windows.h
+  return KB(4);
+#else
+  static u64 page_size = 0;
+  if (!page_size) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    page_size = info.dwPageSize;
+  }
+  return page_size;
+#endif
+}
+
+// NOTE(agent): 0 when large pages can't be used, which is the case unless the user has been given
+// the "Lock pages in memory" privilege
+u64 os_large_page_size(void) {
+#ifdef RAYLIB_H
+  return 0;
+#else
+  static b32 initialized = 0;
+  static u64 large_page_size = 0;
+
+  if (!initialized) {
+    initialized = 1;
+
+    HANDLE token;
+    if (OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES, &token)) {
+      TOKEN_PRIVILEGES privileges = {};
+      privileges.PrivilegeCount = 1;
+      privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+      if (LookupPrivilegeValueA(0, "SeLockMemoryPrivilege", &privileges.Privileges[0].Luid)) {
+        AdjustTokenPrivileges(token, FALSE, &privileges, 0, 0, 0);
+        if (GetLastError() == ERROR_SUCCESS) {
+          large_page_size = GetLargePageMinimum();
+        }
+      }
+
+      CloseHandle(token);
+    }
+  }
+
+  return large_page_size;
+#endif
+}
+
+void *os_memory_reserve(u64 size) {
+  return VirtualAlloc(0, size, MEM_RESERVE, PAGE_READWRITE);
+}
+
+// NOTE(agent): large pages can't be committed separately, size has to be a multiple of
+// os_large_page_size
+void *os_memory_alloc_large(u64 size) {
+  return VirtualAlloc(0, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+}
+
+b32 os_memory_commit(void *data, u64 size) {
+  return VirtualAlloc(data, size, MEM_COMMIT, PAGE_READWRITE) != 0;
+}
+
+void os_memory_decommit(void *data, u64 size) {
+  VirtualFree(data, size, MEM_DECOMMIT);
+}
+
+void os_memory_release(void *data) {
+  VirtualFree(data, 0, MEM_RELEASE);
+}
@@ -12,4 +12,15 @@
 
 string_t read_entire_file(arena_t *arena, char *filename);
 
+u64 os_timer_frequency(void);
+u64 os_timer_read(void);
+
+u64   os_page_size(void);
+u64   os_large_page_size(void);
+void *os_memory_reserve(u64 size);
+void *os_memory_alloc_large(u64 size);
+b32   os_memory_commit(void *data, u64 size);
+void  os_memory_decommit(void *data, u64 size);
+void  os_memory_release(void *data);
+
 #endif // _OS_H
@@ -2,10 +2,106 @@
 #include "instruction.h"
 #include "sim.h"
 
+// NOTE(agent): the printer writes straight into a fixed buffer the caller owns. When the buffer has a
+// file it is flushed with one fwrite whenever it fills up, otherwise whatever doesn't fit is
+// dropped. Nothing here allocates or goes through printf.
+
+// NOTE(agent): enough for the longest instruction, e.g. "xchg word [bp + si - 32768], 65535"
+#define PRINT_INSTRUCTION_MAX 64
+
+struct print_buffer_t {
+  u8 *data;
+  u32 length;
+  u32 capacity;
+  FILE *file;
+};
+
+static print_buffer_t print_buffer_create(u8 *data, u32 capacity, FILE *file) {
+  print_buffer_t result = {};
+  result.data = data;
+  result.capacity = capacity;
+  result.file = file;
+  return result;
+}
+
+static void print_flush(print_buffer_t *buffer) {
+  if (buffer->file && buffer->length) {
+    fwrite(buffer->data, 1, buffer->length, buffer->file);
+  }
+  buffer->length = 0;
+}
 
-static string_t print_operand(arena_t *arena, simulator_t *sim, instruction_t instruction, operand_t operand) {
-  string_t result = {0};
+static void print_bytes(print_buffer_t *buffer, u8 *data, u32 length) {
+  if (buffer->length + length > buffer->capacity && buffer->file) {
+    print_flush(buffer);
+  }
 
+  u32 available = buffer->capacity - buffer->length;
+  if (length > available) {
+    if (buffer->file) {
+      // NOTE(agent): bigger than the whole buffer, so don't bother copying it
+      fwrite(data, 1, length, buffer->file);
+      return;
+    }
+    length = available;
+  }
+
+  memcpy(buffer->data + buffer->length, data, length);
+  buffer->length += length;
+}
+
+static void print_string(print_buffer_t *buffer, string_t string) {
+  print_bytes(buffer, string.data, (u32)string.length);
+}
+
+static void print_char(print_buffer_t *buffer, u8 c) {
+  if (buffer->length == buffer->capacity && buffer->file) {
+    print_flush(buffer);
+  }
+  if (buffer->length < buffer->capacity) {
+    buffer->data[buffer->length++] = c;
+  }
+}
+
+static void print_u32(print_buffer_t *buffer, u32 value) {
+  u8 digits[10];
+  u32 count = 0;
+  do {
+    digits[sizeof(digits) - 1 - count] = (u8)('0' + (value % 10));
+    value /= 10;
+    count += 1;
+  } while (value);
+
+  print_bytes(buffer, digits + sizeof(digits) - count, count);
+}
+
+static void print_s32(print_buffer_t *buffer, s32 value) {
+  u32 magnitude = (u32)value;
+  if (value < 0) {
+    print_char(buffer, '-');
+    magnitude = 0u - magnitude;
+  }
+  print_u32(buffer, magnitude);
+}
+
+// NOTE(agent): lowercase and without leading zeros, same as %x
+static void print_hex(print_buffer_t *buffer, u32 value) {
+  static const u8 hex_digits[] = "0123456789abcdef";
+
+  u8 digits[8];
+  u32 count = 0;
+  do {
+    digits[sizeof(digits) - 1 - count] = hex_digits[value & 0xf];
+    value >>= 4;
+    count += 1;
+  } while (value);
+
+  print_bytes(buffer, digits + sizeof(digits) - count, count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static void print_operand(print_buffer_t *buffer, instruction_t instruction, operand_t operand) {
   u32 instruction_flags = instruction.flags;
 
   switch (operand.kind) {
@@ -15,84 +111,68 @@ static string_t print_operand(arena_t *arena, simulator_t *sim, instruction_t in
     if (instruction_flags & INSTRUCTION_FLAG_JUMP) {
       s8 inc = (s8)operand.immediate;
       inc += instruction_size;
-      result = string_pushf(arena, "$%d", (s8)inc);
+      print_char(buffer, '$');
+      print_s32(buffer, (s8)inc);
     } else if (instruction_flags & INSTRUCTION_FLAG_SIGN_EXTEND) {
-      result = string_pushf(arena, "%d", (s16)operand.immediate);
+      print_s32(buffer, (s16)operand.immediate);
     } else {
-      result = string_pushf(arena, "%d", operand.immediate);
+      print_u32(buffer, operand.immediate);
     }
   } break;
   case OPERAND_KIND_REGISTER: {
-    result = register_names[operand.reg];
+    print_string(buffer, register_names[operand.reg]);
   } break;
   case OPERAND_KIND_ADDRESS: {
     address_t addr = operand.address;
 
-    string_list_t sb = {0};
-
     if (instruction_flags & INSTRUCTION_FLAG_SPECIFY_SIZE) {
       string_t size = (instruction_flags & INSTRUCTION_FLAG_WIDE) ? STRING_LIT("word ") : STRING_LIT("byte ");
-      string_list_push(arena, &sb, size);
+      print_string(buffer, size);
     }
 
-    string_list_push(arena, &sb, STRING_LIT("["));
+    print_char(buffer, '[');
     if (addr.register_count > 0) {
-      string_t reg = register_names[addr.registers[0]];
-      string_list_push(arena, &sb, reg);
+      print_string(buffer, register_names[addr.registers[0]]);
     }
     if (addr.register_count > 1 && addr.registers[1] != REGISTER_NONE) {
-      string_t reg = register_names[addr.registers[1]];
-      string_list_pushf(arena, &sb, " + %.*s", STRING_FMT(reg));
+      print_string(buffer, STRING_LIT(" + "));
+      print_string(buffer, register_names[addr.registers[1]]);
     }
     if (addr.offset) {
       s16 offset = addr.offset >= 0 ? addr.offset : -addr.offset;
       if (addr.register_count) {
-        string_list_pushf(arena, &sb, " %s %d", addr.offset >= 0 ? "+" : "-", offset);
-      } else {
-        string_list_pushf(arena, &sb, "%d", offset);
+        print_string(buffer, addr.offset >= 0 ? STRING_LIT(" + ") : STRING_LIT(" - "));
       }
+      print_s32(buffer, offset);
     }
-    string_list_push(arena, &sb, STRING_LIT("]"));
-    result = string_list_join(arena, &sb, {});
+    print_char(buffer, ']');
   } break;
 
   case OPERAND_KIND_NONE:
   case OPERAND_KIND_COUNT:
     break;
   }
-
-  return result;
 }
 
-static string_t print_instruction(arena_t *arena, simulator_t *sim, instruction_t instruction) {
-  string_t result;
-
-  string_t opcode = op_code_names[instruction.opcode];
-  string_t dest = print_operand(arena, sim, instruction, instruction.dest);
+static void print_instruction(print_buffer_t *buffer, instruction_t instruction) {
+  print_string(buffer, op_code_names[instruction.opcode]);
+  print_char(buffer, ' ');
+  print_operand(buffer, instruction, instruction.dest);
 
   if (instruction.source.kind != OPERAND_KIND_NONE) {
-    string_t source = print_operand(arena, sim, instruction, instruction.source);
-    result = string_pushf(arena, "%.*s %.*s, %.*s", STRING_FMT(opcode), STRING_FMT(dest), STRING_FMT(source));
-  } else {
-    result = string_pushf(arena, "%.*s %.*s", STRING_FMT(opcode), STRING_FMT(dest));
+    print_string(buffer, STRING_LIT(", "));
+    print_operand(buffer, instruction, instruction.source);
   }
-
-  return result;
 }
 
-static string_t print_flags(arena_t *arena, u16 flags) {
-  string_list_t sb = {};
-
-  if (flags & FLAG_CARRY)            string_list_push(arena, &sb, STRING_LIT("C"));
-  if (flags & FLAG_PARITY)           string_list_push(arena, &sb, STRING_LIT("P"));
-  if (flags & FLAG_AUXILIARY_CARRY)  string_list_push(arena, &sb, STRING_LIT("A"));
-  if (flags & FLAG_ZERO)             string_list_push(arena, &sb, STRING_LIT("Z"));
-  if (flags & FLAG_SIGN)             string_list_push(arena, &sb, STRING_LIT("S"));
-  if (flags & FLAG_TRAP)             string_list_push(arena, &sb, STRING_LIT("T"));
-  if (flags & FLAG_INTERRUPT_ENABLE) string_list_push(arena, &sb, STRING_LIT("I"));
-  if (flags & FLAG_DIRECTION)        string_list_push(arena, &sb, STRING_LIT("D"));
-  if (flags & FLAG_OVERFLOW)         string_list_push(arena, &sb, STRING_LIT("O"));
-
-  return string_list_join(arena, &sb, {});
+static void print_flags(print_buffer_t *buffer, u16 flags) {
+  if (flags & FLAG_CARRY)            print_char(buffer, 'C');
+  if (flags & FLAG_PARITY)           print_char(buffer, 'P');
+  if (flags & FLAG_AUXILIARY_CARRY)  print_char(buffer, 'A');
+  if (flags & FLAG_ZERO)             print_char(buffer, 'Z');
+  if (flags & FLAG_SIGN)             print_char(buffer, 'S');
+  if (flags & FLAG_TRAP)             print_char(buffer, 'T');
+  if (flags & FLAG_INTERRUPT_ENABLE) print_char(buffer, 'I');
+  if (flags & FLAG_DIRECTION)        print_char(buffer, 'D');
+  if (flags & FLAG_OVERFLOW)         print_char(buffer, 'O');
 }
-
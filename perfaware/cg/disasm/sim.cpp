@@ -349,7 +349,8 @@ static u32 instruction_estimate_clocks(simulator_t *sim, instruction_t instructi
   return result;
 }
 
-static instruction_t instruction_decode(simulator_t *sim, u32 offset) {
+// NOTE(agent): the original decoder, kept as the reference for instruction_decode (see decode_bench.cpp)
+static instruction_t instruction_decode_switch(simulator_t *sim, u32 offset) {
   string_t instruction_stream = { 0 };
   instruction_stream.data = sim->memory + offset;
   instruction_stream.length = sim->code_end - offset;
@@ -893,6 +894,338 @@ static instruction_t instruction_decode(simulator_t *sim, u32 offset) {
   return result;
 }
 
+// -----------------------------------------------------------------------------
+// table driven decoder
+//
+// NOTE(agent): every first byte maps to a descriptor saying which operand form it has, whether a ModRM
+// byte follows, and how many immediate bytes come after that. The bytes are read straight from
+// memory, and the stream length is checked once per instruction rather than once per byte.
+
+enum decode_form_t : u8 {
+  DECODE_FORM_NONE,
+  // ---------------------------------------------------------------------------
+  DECODE_FORM_REG_RM,     // op r/m, reg (or reg, r/m with d)
+  DECODE_FORM_ACC_IMM,    // op al/ax, data
+  DECODE_FORM_REG,        // op with an implied register (push/pop)
+  DECODE_FORM_RM,         // op r/m (pop)
+  DECODE_FORM_XCHG,       // xchg reg, r/m
+  DECODE_FORM_JUMP,       // jcc/loop, inc8
+  DECODE_FORM_IMM_RM,     // add/sub/cmp r/m, data (0x80 group)
+  DECODE_FORM_SR_RM,      // mov r/m, sr (or sr, r/m with d)
+  DECODE_FORM_ACC_MEM,    // mov al/ax, [addr] (or [addr], al/ax with d)
+  DECODE_FORM_REG_IMM,    // mov reg, data
+  DECODE_FORM_INT3,
+  DECODE_FORM_MOV_IMM_RM, // mov r/m, data
+  DECODE_FORM_GROUP_FF,   // inc/push r/m
+  // ---------------------------------------------------------------------------
+  DECODE_FORM_COUNT,
+};
+
+struct decode_entry_t {
+  op_code_t     opcode;
+  decode_form_t form;
+  register_t    reg;       // implied register
+  u8            modrm;     // a ModRM byte (and maybe displacement) follows the first byte
+  u8            w;         // width of the reg and r/m operands
+  u8            d;         // reg (or sr, or al/ax) is the destination
+  u8            imm_bytes; // immediate bytes after ModRM and displacement
+  u8            imm_sign;  // a one byte immediate is sign extended
+  u8            flags;     // instruction_flag_t bits the decoded instruction gets
+};
+
+static decode_entry_t decode_table[256];
+
+// NOTE(agent): the 0x80 group picks its opcode with the reg field
+static op_code_t decode_group_80_opcodes[8] = {
+  OP_CODE_ADD, OP_CODE_NONE, OP_CODE_NONE, OP_CODE_NONE, OP_CODE_NONE, OP_CODE_SUB, OP_CODE_NONE, OP_CODE_CMP,
+};
+static const char *decode_group_80_errors[8] = {
+  0, "Invalid op: 1", "TODO: adc", "TODO: sbb", "Invalid op: 4", 0, "Invalid op: 6", 0,
+};
+
+static void init_decode_table() {
+  // NOTE(agent): everything matches what instruction_decode_switch produces, quirks included
+  op_code_t reg_rm_opcodes[4] = { OP_CODE_ADD, OP_CODE_SUB, OP_CODE_CMP, OP_CODE_MOV };
+  u8 reg_rm_bases[4] = { 0x00, 0x28, 0x38, 0x88 };
+  for (u32 i = 0; i < 4; i += 1) {
+    for (u8 bits = 0; bits < 4; bits += 1) {
+      decode_entry_t *entry = &decode_table[reg_rm_bases[i] + bits];
+      entry->opcode = reg_rm_opcodes[i];
+      entry->form   = DECODE_FORM_REG_RM;
+      entry->modrm  = 1;
+      entry->w      = bits & 1;
+      entry->d      = (bits >> 1) & 1;
+      entry->flags  = entry->w ? INSTRUCTION_FLAG_WIDE : 0;
+    }
+  }
+
+  op_code_t acc_imm_opcodes[3] = { OP_CODE_ADD, OP_CODE_SUB, OP_CODE_CMP };
+  u8 acc_imm_bases[3] = { 0x04, 0x2C, 0x3C };
+  for (u32 i = 0; i < 3; i += 1) {
+    for (u8 w = 0; w < 2; w += 1) {
+      decode_entry_t *entry = &decode_table[acc_imm_bases[i] + w];
+      entry->opcode    = acc_imm_opcodes[i];
+      entry->form      = DECODE_FORM_ACC_IMM;
+      entry->reg       = w ? REGISTER_AX : REGISTER_AL;
+      entry->w         = w;
+      entry->imm_bytes = w ? 2 : 1;
+      entry->flags     = w ? INSTRUCTION_FLAG_WIDE : 0;
+    }
+  }
+
+  decode_table[0x0E] = { OP_CODE_PUSH, DECODE_FORM_REG, REGISTER_CS };
+  decode_table[0x1E] = { OP_CODE_PUSH, DECODE_FORM_REG, REGISTER_DS };
+  decode_table[0x1F] = { OP_CODE_POP,  DECODE_FORM_REG, REGISTER_DS };
+  for (u8 i = 0; i < 8; i += 1) {
+    // NOTE(agent): same register numbering as instruction_decode_switch
+    register_t reg = (register_t)((s32)REGISTER_AX + i);
+    decode_table[0x50 + i] = { OP_CODE_PUSH, DECODE_FORM_REG, reg };
+    decode_table[0x58 + i] = { OP_CODE_POP,  DECODE_FORM_REG, reg };
+  }
+
+  decode_table[0x8F] = { OP_CODE_POP,  DECODE_FORM_RM,   REGISTER_NONE, 1, 0 };
+  decode_table[0x87] = { OP_CODE_XCHG, DECODE_FORM_XCHG, REGISTER_NONE, 1, 1, 0, 0, 0, INSTRUCTION_FLAG_WIDE };
+
+  op_code_t jump_opcodes[16] = {
+    OP_CODE_JO, OP_CODE_JNO, OP_CODE_JB, OP_CODE_JNB, OP_CODE_JE, OP_CODE_JNZ, OP_CODE_JBE, OP_CODE_JA,
+    OP_CODE_JS, OP_CODE_JNS, OP_CODE_JP, OP_CODE_JNP, OP_CODE_JL, OP_CODE_JNL, OP_CODE_JLE, OP_CODE_JG,
+  };
+  for (u8 i = 0; i < 16; i += 1) {
+    decode_table[0x70 + i] = { jump_opcodes[i], DECODE_FORM_JUMP, REGISTER_NONE, 0, 0, 0, 1, 1, INSTRUCTION_FLAG_JUMP };
+  }
+  op_code_t loop_opcodes[4] = { OP_CODE_LOOPNZ, OP_CODE_LOOPZ, OP_CODE_LOOP, OP_CODE_JCXZ };
+  for (u8 i = 0; i < 4; i += 1) {
+    decode_table[0xE0 + i] = { loop_opcodes[i], DECODE_FORM_JUMP, REGISTER_NONE, 0, 0, 0, 1, 1, INSTRUCTION_FLAG_JUMP };
+  }
+
+  for (u8 bits = 0; bits < 4; bits += 1) {
+    u8 s = (bits >> 1) & 1;
+    u8 w = bits & 1;
+
+    decode_entry_t *entry = &decode_table[0x80 + bits];
+    entry->form      = DECODE_FORM_IMM_RM;
+    entry->modrm     = 1;
+    entry->w         = w;
+    entry->imm_bytes = (w && !s) ? 2 : 1;
+    entry->imm_sign  = s && w;
+    entry->flags     = (w ? INSTRUCTION_FLAG_WIDE : 0) | (s ? INSTRUCTION_FLAG_SIGN_EXTEND : 0);
+  }
+
+  decode_table[0x8C] = { OP_CODE_MOV, DECODE_FORM_SR_RM, REGISTER_NONE, 1, 1, 0 };
+  decode_table[0x8E] = { OP_CODE_MOV, DECODE_FORM_SR_RM, REGISTER_NONE, 1, 1, 1 };
+
+  for (u8 bits = 0; bits < 4; bits += 1) {
+    u8 w = bits & 1;
+    u8 d = (bits >> 1) & 1;
+    decode_table[0xA0 + bits] = { OP_CODE_MOV, DECODE_FORM_ACC_MEM, w ? REGISTER_AX : REGISTER_AL, 0, w, d, 2, 0,
+                                  (u8)(w ? INSTRUCTION_FLAG_WIDE : 0) };
+  }
+
+  for (u8 i = 0; i < 16; i += 1) {
+    u8 w = i >= 8;
+    decode_table[0xB0 + i] = { OP_CODE_MOV, DECODE_FORM_REG_IMM, get_register(i % 8, w), 0, w, 0, (u8)(w ? 2 : 1), 0,
+                               (u8)(w ? INSTRUCTION_FLAG_WIDE : 0) };
+  }
+
+  decode_table[0xCC] = { OP_CODE_INT, DECODE_FORM_INT3 };
+
+  for (u8 w = 0; w < 2; w += 1) {
+    decode_table[0xC6 + w] = { OP_CODE_MOV, DECODE_FORM_MOV_IMM_RM, REGISTER_NONE, 1, w, 0, (u8)(w ? 2 : 1), 0,
+                               (u8)(w ? INSTRUCTION_FLAG_WIDE : 0) };
+  }
+
+  decode_table[0xFF] = { OP_CODE_NONE, DECODE_FORM_GROUP_FF, REGISTER_NONE, 1, 1 };
+}
+
+static inline u16 decode_u16(u8 *p) {
+  u16 result = (u16)(p[0] | (p[1] << 8));
+  return result;
+}
+
+static operand_t decode_rm(u8 **at, u8 w, u8 mod, u8 rm) {
+  operand_t result = {};
+  u8 *p = *at;
+
+  if (mod == 3) {
+    result.kind = OPERAND_KIND_REGISTER;
+    result.reg = get_register(rm, w);
+  } else if (mod == 0 && rm == 6) {
+    result.kind = OPERAND_KIND_ADDRESS;
+    result.address.offset = decode_u16(p);
+    p += 2;
+  } else {
+    result.kind = OPERAND_KIND_ADDRESS;
+    result.address.registers[0] = effective_address[0][rm];
+    result.address.registers[1] = effective_address[1][rm];
+    result.address.register_count = (result.address.registers[1] != REGISTER_NONE) ? 2 : 1;
+    if (mod == 1) {
+      // NOTE(agent): not sign extended, same as next_address
+      result.address.offset = p[0];
+      p += 1;
+    } else if (mod == 2) {
+      result.address.offset = decode_u16(p);
+      p += 2;
+    }
+  }
+
+  *at = p;
+  return result;
+}
+
+static instruction_t instruction_decode(simulator_t *sim, u32 offset) {
+  instruction_t result = {};
+  result.ip = sim->memory + offset;
+
+  // NOTE(agent): the one bounds check - near the end of the code the bytes are decoded from a zero padded
+  // copy instead, and the length is checked against what was really there afterwards
+  u32 available = (offset < sim->code_end) ? (sim->code_end - offset) : 0;
+  u8 padded[INSTRUCTION_MAX_BYTE_COUNT];
+  u8 *start = result.ip;
+  if (available < INSTRUCTION_MAX_BYTE_COUNT) {
+    memset(padded, 0, sizeof(padded));
+    memcpy(padded, start, available);
+    start = padded;
+  }
+  u8 *at = start;
+
+  u8 b1 = *at++;
+  decode_entry_t entry = decode_table[b1];
+
+  u8 reg = 0;
+  operand_t op_rm = {};
+  if (entry.modrm) {
+    u8 b2 = *at++;
+    u8 mod = (b2 >> 6);
+    u8 rm = (b2 >> 0) & 7;
+    reg = (b2 >> 3) & 7;
+
+    // NOTE(agent): an unknown 0xFF op stops before its displacement, like instruction_decode_switch does
+    if (entry.form != DECODE_FORM_GROUP_FF || reg == 0 || reg == 6) {
+      op_rm = decode_rm(&at, entry.w, mod, rm);
+    }
+  }
+
+  u16 data = 0;
+  if (entry.imm_bytes == 2) {
+    data = decode_u16(at);
+    at += 2;
+  } else if (entry.imm_bytes == 1) {
+    data = entry.imm_sign ? (u16)(s16)(s8)at[0] : at[0];
+    at += 1;
+  }
+
+  result.opcode = entry.opcode;
+  result.flags = entry.flags;
+
+  switch (entry.form) {
+  case DECODE_FORM_REG_RM: {
+    operand_t op_register = {OPERAND_KIND_REGISTER};
+    op_register.reg = get_register(reg, entry.w);
+
+    result.dest = entry.d ? op_register : op_rm;
+    result.source = entry.d ? op_rm : op_register;
+
+    if (result.dest.kind == OPERAND_KIND_ADDRESS) {
+      result.flags |= INSTRUCTION_FLAG_SPECIFY_SIZE;
+    }
+  } break;
+
+  case DECODE_FORM_ACC_IMM:
+  case DECODE_FORM_REG_IMM: {
+    result.dest.kind = OPERAND_KIND_REGISTER;
+    result.dest.reg = entry.reg;
+    result.source.kind = OPERAND_KIND_IMMEDIATE;
+    result.source.immediate = data;
+  } break;
+
+  case DECODE_FORM_REG: {
+    result.dest.kind = OPERAND_KIND_REGISTER;
+    result.dest.reg = entry.reg;
+  } break;
+
+  case DECODE_FORM_RM: {
+    result.dest = op_rm;
+  } break;
+
+  case DECODE_FORM_XCHG: {
+    result.dest.kind = OPERAND_KIND_REGISTER;
+    result.dest.reg = get_register(reg, entry.w);
+    result.source = op_rm;
+  } break;
+
+  case DECODE_FORM_JUMP:
+  case DECODE_FORM_INT3: {
+    result.dest.kind = OPERAND_KIND_IMMEDIATE;
+    result.dest.immediate = (entry.form == DECODE_FORM_INT3) ? 3 : data;
+  } break;
+
+  case DECODE_FORM_IMM_RM: {
+    result.opcode = decode_group_80_opcodes[reg];
+    if (decode_group_80_errors[reg]) {
+      SIM_ERROR(sim, "%s", decode_group_80_errors[reg]);
+    }
+
+    result.dest = op_rm;
+    result.source.kind = OPERAND_KIND_IMMEDIATE;
+    result.source.immediate = data;
+  } break;
+
+  case DECODE_FORM_SR_RM: {
+    operand_t op_sr = {OPERAND_KIND_REGISTER};
+    op_sr.reg = (register_t)(REGISTER_ES + (reg & 3));
+
+    result.dest = entry.d ? op_sr : op_rm;
+    result.source = entry.d ? op_rm : op_sr;
+  } break;
+
+  case DECODE_FORM_ACC_MEM: {
+    operand_t op_addr = {OPERAND_KIND_ADDRESS};
+    op_addr.address.offset = data;
+
+    operand_t op_reg = {OPERAND_KIND_REGISTER};
+    op_reg.reg = entry.reg;
+
+    result.dest = entry.d ? op_addr : op_reg;
+    result.source = entry.d ? op_reg : op_addr;
+  } break;
+
+  case DECODE_FORM_MOV_IMM_RM: {
+    result.dest = op_rm;
+    result.source.kind = OPERAND_KIND_IMMEDIATE;
+    result.source.immediate = data;
+
+    if (op_rm.kind == OPERAND_KIND_ADDRESS) {
+      result.flags |= INSTRUCTION_FLAG_SPECIFY_SIZE;
+    }
+  } break;
+
+  case DECODE_FORM_GROUP_FF: {
+    if (reg == 6) {
+      result.opcode = OP_CODE_PUSH;
+      result.dest = op_rm;
+    } else if (reg == 0) {
+      result.opcode = OP_CODE_INC;
+      result.dest = op_rm;
+    } else {
+      SIM_ERROR(sim, "Unexpected op: 0b%.*s", 3, &bit_string_u8(reg)[6]);
+    }
+  } break;
+
+  case DECODE_FORM_NONE:
+  case DECODE_FORM_COUNT: {
+    SIM_ERROR(sim, "Unexpected instruction 0x%02x 0b%s", b1, bit_string_u8(b1));
+  } break;
+  }
+
+  u32 bytes_count = (u32)(at - start);
+  if (bytes_count > available) {
+    SIM_ERROR(sim, "Unexpected end of instruction stream at 0x%x", offset);
+  }
+  result.bytes_count = (u8)bytes_count;
+
+  return result;
+}
+
 static void flag_set(u16 *flags, flag_t flag, b32 value) {
   if (value) *flags |=  (1 << flag);
   else       *flags &= ~(1 << flag);
@@ -1229,7 +1562,8 @@ void sim_reset(simulator_t *sim) {
   sim->ip = 0;
   sim->error.length = 0;
 
-  arena_reset(sim->arena);
+  // NOTE(agent): the arena isn't reset here, sim->memory lives in it and everything else the simulator
+  // pushes is temporary
 
   memset(sim->memory + sim->code_end,  0, MB(1) - sim->code_end);
   memset(sim->registers,               0, ARRAY_COUNT(sim->registers));
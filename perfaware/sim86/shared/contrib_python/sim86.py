@@ -105,6 +105,35 @@ def decode_8086_instruction(data: bytes, offset: int) -> Instruction:
   _decode_8086_instruction(length, ptr, ctypes.byref(decoded))
   return _make(decoded)
 
+def decode_8086_stream(data: bytes, offset: int = 0, max_count: typing.Optional[int] = None) -> list[Instruction]:
+  """Decodes instructions from data starting at offset, stopping at the end of the data, after
+  max_count instructions, or at the first unrecognized instruction. Each instruction's address
+  is its offset into data."""
+  assert isinstance(data, bytes)
+  if max_count is None:
+    max_count = len(data) - offset
+  if _decode_8086_stream is None:
+    return _decode_8086_stream_one_at_a_time(data, offset, max_count)
+
+  base = ctypes.addressof(ctypes.cast(data, ctypes.POINTER(ctypes.c_ubyte)).contents)
+  batch = (_instruction * min(max(max_count, 1), _STREAM_BATCH_COUNT))()
+  count = u32()
+  result = []
+  while offset < len(data) and len(result) < max_count:
+    want = min(len(batch), max_count - len(result))
+    _decode_8086_stream(len(data) - offset, base + offset, batch, want, ctypes.byref(count))
+    for i in range(count.value):
+      decoded = _make(batch[i])
+      decoded.address += offset
+      result.append(decoded)
+    if count.value == 0:
+      break
+    last = batch[count.value - 1]
+    offset += last.address + last.size
+    if count.value < want:
+      break
+  return result
+
 def register_name_from_operand(register_access: RegisterAccess) -> str:
   access = _register_access(register_access.index, register_access.offset, register_access.count)
   return _register_name_from_operand(ctypes.byref(access)).decode("ascii")
@@ -117,6 +146,64 @@ def get_8086_instruction_table() -> InstructionTable:
   _get_8086_instruction_table(ctypes.byref(t))
   return _make(t)
 
+MachineFlag = IntFlag("MachineFlag", """
+  stop_on_ret assume_8088
+""".split())
+
+Status = IntEnum("Status", """
+  running outside_program stop_on_ret unrecognized_instruction unimplemented_instruction
+""".split(), start=0)
+
+class Machine:
+  """An 8086 that runs inside the dll, so programs execute at native speed."""
+
+  def __init__(self, flags: MachineFlag = MachineFlag(0)):
+    # the dll never allocates, so the machine's memory is owned by this object
+    self._memory = (ctypes.c_uint64 * ((_get_machine_size() + 7) // 8))()
+    self._machine = _create_machine(ctypes.sizeof(self._memory), self._memory, flags)
+    assert self._machine
+
+  def load_program(self, data: bytes):
+    _load_program(self._machine, len(data), data)
+
+  def step(self) -> tuple[Status, Instruction]:
+    executed = _instruction()
+    status = _step(self._machine, ctypes.byref(executed))
+    return Status(status), _make(executed)
+
+  def run(self, max_instruction_count: int = 0xffffffff) -> Status:
+    return Status(_run(self._machine, max_instruction_count))
+
+  def instruction_count(self) -> int:
+    return _get_instruction_count(self._machine)
+
+  def get_register(self, index: int) -> int:
+    return _get_register(self._machine, index)
+
+  def set_register(self, index: int, value: int):
+    _set_register(self._machine, index, value)
+
+  def read_memory(self, address: int, count: int) -> bytes:
+    buffer = (u8 * count)()
+    read = _read_memory(self._machine, address, count, buffer)
+    return bytes(buffer[:read])
+
+  def write_memory(self, address: int, data: bytes) -> int:
+    return _write_memory(self._machine, address, len(data), data)
+
+  def clocks(self) -> tuple[int, int]:
+    min_clocks, max_clocks = u32(), u32()
+    _get_clocks(self._machine, ctypes.byref(min_clocks), ctypes.byref(max_clocks))
+    return min_clocks.value, max_clocks.value
+
+def estimate_instruction_clocks(data: bytes, offset: int, flags: MachineFlag = MachineFlag(0)) -> tuple[int, int]:
+  decoded = _instruction()
+  ptr = ctypes.addressof(ctypes.cast(data, ctypes.POINTER(ctypes.c_ubyte)).contents) + offset
+  _decode_8086_instruction(len(data) - offset, ptr, ctypes.byref(decoded))
+  min_clocks, max_clocks = u32(), u32()
+  _estimate_instruction_clocks(ctypes.byref(decoded), flags, ctypes.byref(min_clocks), ctypes.byref(max_clocks))
+  return min_clocks.value, max_clocks.value
+
 
 ### implementation details
 
@@ -208,6 +295,26 @@ _get_version.restype = u32
 _decode_8086_instruction = dll.Sim86_Decode8086Instruction
 _decode_8086_instruction.argtypes = [u32, ctypes.c_void_p, ctypes.POINTER(_instruction)]
 
+# NOTE: DLLs built before Sim86_Decode8086Stream existed do not export it, in which case
+# decode_8086_stream falls back to decoding one instruction per call.
+_decode_8086_stream = getattr(dll, "Sim86_Decode8086Stream", None)
+if _decode_8086_stream is not None:
+  _decode_8086_stream.argtypes = [u32, ctypes.c_void_p, ctypes.POINTER(_instruction), u32, ctypes.POINTER(u32)]
+
+# number of instructions decoded per call into the dll
+_STREAM_BATCH_COUNT = 4096
+
+def _decode_8086_stream_one_at_a_time(data, offset, max_count):
+  result = []
+  while offset < len(data) and len(result) < max_count:
+    decoded = decode_8086_instruction(data, offset)
+    if decoded.op == OperationType.none or decoded.size > len(data) - offset:
+      break
+    decoded.address = offset
+    result.append(decoded)
+    offset += decoded.size
+  return result
+
 _register_name_from_operand = dll.Sim86_RegisterNameFromOperand
 _register_name_from_operand.argtypes = [ctypes.POINTER(_register_access)]
 _register_name_from_operand.restype = ctypes.c_char_p
@@ -219,6 +326,33 @@ _mnemonic_from_operation_type.restype = ctypes.c_char_p
 _get_8086_instruction_table = dll.Sim86_Get8086InstructionTable
 _get_8086_instruction_table.argtypes = [ctypes.POINTER(_instruction_table)]
 
+# NOTE: DLLs built before the machine functions existed do not export them. They are bound here
+# so that importing this module still works with such a DLL, and only using Machine or
+# estimate_instruction_clocks raises.
+def _machine_function(name, argtypes, restype=None):
+  function = getattr(dll, name, None)
+  if function is None:
+    def missing(*args):
+      raise NotImplementedError(f"{name} is not exported by this dll, rebuild it from sim86_lib.cpp")
+    return missing
+  function.argtypes = argtypes
+  if restype is not None:
+    function.restype = restype
+  return function
+
+_get_machine_size = _machine_function("Sim86_GetMachineSize", [], u32)
+_create_machine = _machine_function("Sim86_CreateMachine", [u32, ctypes.c_void_p, u32], ctypes.c_void_p)  # u32 is MachineFlag
+_load_program = _machine_function("Sim86_LoadProgram", [ctypes.c_void_p, u32, ctypes.c_char_p])
+_step = _machine_function("Sim86_Step", [ctypes.c_void_p, ctypes.POINTER(_instruction)], u32)  # returns Status
+_run = _machine_function("Sim86_Run", [ctypes.c_void_p, u32], u32)  # returns Status
+_get_instruction_count = _machine_function("Sim86_GetInstructionCount", [ctypes.c_void_p], ctypes.c_uint64)
+_get_register = _machine_function("Sim86_GetRegister", [ctypes.c_void_p, u32], u32)
+_set_register = _machine_function("Sim86_SetRegister", [ctypes.c_void_p, u32, u32])
+_read_memory = _machine_function("Sim86_ReadMemory", [ctypes.c_void_p, u32, u32, ctypes.c_void_p], u32)
+_write_memory = _machine_function("Sim86_WriteMemory", [ctypes.c_void_p, u32, u32, ctypes.c_char_p], u32)
+_get_clocks = _machine_function("Sim86_GetClocks", [ctypes.c_void_p, ctypes.POINTER(u32), ctypes.POINTER(u32)])
+_estimate_instruction_clocks = _machine_function("Sim86_EstimateInstructionClocks", [ctypes.POINTER(_instruction), u32, ctypes.POINTER(u32), ctypes.POINTER(u32)])
+
 ### helper function to convert ctypes -> dataclass
 
 def _make(obj):
@@ -271,15 +271,46 @@ struct instruction_table
     u32 EncodingCount;
     u32 MaxInstructionByteCount;
 };
+
+typedef struct sim86_machine sim86_machine;
+
+typedef enum sim86_machine_flag : u32
+{
+    Sim86Machine_StopOnRet = 0x1,
+    Sim86Machine_Assume8088 = 0x2,
+} sim86_machine_flag;
+
+typedef enum sim86_status : u32
+{
+    Sim86Status_Running,
+    Sim86Status_OutsideProgram,
+    Sim86Status_StopOnRet,
+    Sim86Status_UnrecognizedInstruction,
+    Sim86Status_UnimplementedInstruction,
+} sim86_status;
 #ifdef __cplusplus
 extern "C"
 {
 #endif
     u32 Sim86_GetVersion(void);
     void Sim86_Decode8086Instruction(u32 SourceSize, u8 *Source, instruction *Dest);
+    void Sim86_Decode8086Stream(u32 SourceSize, u8 *Source, instruction *Dest, u32 MaxCount, u32 *OutCount);
     char const *Sim86_RegisterNameFromOperand(register_access *RegAccess);
     char const *Sim86_MnemonicFromOperationType(operation_type Type);
     void Sim86_Get8086InstructionTable(instruction_table *Dest);
+
+    u32 Sim86_GetMachineSize(void);
+    sim86_machine *Sim86_CreateMachine(u32 MemorySize, void *Memory, u32 MachineFlags);
+    void Sim86_LoadProgram(sim86_machine *Machine, u32 SourceSize, u8 *Source);
+    sim86_status Sim86_Step(sim86_machine *Machine, instruction *Executed);
+    sim86_status Sim86_Run(sim86_machine *Machine, u32 MaxInstructionCount);
+    u64 Sim86_GetInstructionCount(sim86_machine *Machine);
+    u32 Sim86_GetRegister(sim86_machine *Machine, register_index Index);
+    void Sim86_SetRegister(sim86_machine *Machine, register_index Index, u32 Value);
+    u32 Sim86_ReadMemory(sim86_machine *Machine, u32 Address, u32 Count, u8 *Dest);
+    u32 Sim86_WriteMemory(sim86_machine *Machine, u32 Address, u32 Count, u8 *Source);
+    void Sim86_GetClocks(sim86_machine *Machine, u32 *MinClocks, u32 *MaxClocks);
+    void Sim86_EstimateInstructionClocks(instruction *Instruction, u32 MachineFlags, u32 *MinClocks, u32 *MaxClocks);
 #ifdef __cplusplus
 }
 #endif
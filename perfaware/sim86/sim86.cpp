@@ -31,18 +31,35 @@
 #include "sim86_instruction_table.h"
 #include "sim86_memory.h"
 #include "sim86_decode.h"
+#include "sim86_decode_cache.h"
 #include "sim86_execute.h"
+#include "sim86_blocks.h"
 #include "sim86_cycles.h"
 #include "sim86_text.h"
+#include "sim86_platform.h"
+#include "sim86_trace.h"
+#include "sim86_records.h"
+#include "sim86_profile.h"
+#include "sim86_snapshot.h"
+#include "sim86_memdump.h"
 
 #include "sim86_instruction.cpp"
 #include "sim86_instruction_table.cpp"
 #include "sim86_memory.cpp"
 #include "sim86_decode.cpp"
+#include "sim86_decode_compiled.cpp"
+#include "sim86_decode_cache.cpp"
 #include "sim86_execute.cpp"
 #include "sim86_cycles.cpp"
 #include "sim86_text_table.cpp"
 #include "sim86_text.cpp"
+#include "sim86_blocks.cpp"
+#include "sim86_platform.cpp"
+#include "sim86_trace.cpp"
+#include "sim86_records.cpp"
+#include "sim86_profile.cpp"
+#include "sim86_snapshot.cpp"
+#include "sim86_memdump.cpp"
 
 enum sim_flags
 {
@@ -51,8 +68,40 @@ enum sim_flags
     SimFlag_DumpMemory = 0x4,
     SimFlag_ExplainClocks = 0x8,
     SimFlag_NoRegisterDiffs = 0x10,
+    SimFlag_NoDecodeCache = 0x20,
+    SimFlag_ShowCacheStats = 0x40,
+    SimFlag_BlockExec = 0x80,
+    SimFlag_Quiet = 0x100,
+    SimFlag_Trace = 0x200,
+    SimFlag_BusClocks = 0x400,
+    SimFlag_Profile = 0x800,
+    SimFlag_FoldedStacks = 0x1000,
+    SimFlag_Snapshot = 0x2000,
+    SimFlag_Resume = 0x4000,
+    SimFlag_DumpPages = 0x8000,
+    SimFlag_Stream = 0x10000,
+    SimFlag_Parallel = 0x20000,
+    SimFlag_JSONRecords = 0x40000,
+    SimFlag_CSVRecords = 0x80000,
 };
 
+struct snapshot_request
+{
+    u64 AtInstructionCount;
+    char const *FileName;
+};
+
+// NOTE(agent): Trace records are collected in this much memory before each write to the trace file.
+#define TRACE_BUFFER_SIZE (4*1024*1024)
+
+// NOTE(agent): Same for -json and -csv records.
+#define RECORD_BUFFER_SIZE (4*1024*1024)
+
+// NOTE(agent): -stream reads the file this many bytes at a time, and writes its output through
+// a stdout buffer this large.
+#define STREAM_CHUNK_SIZE_POW2 20
+#define STREAM_OUTPUT_BUFFER_SIZE (4*1024*1024)
+
 static u32 LoadMemoryFromFile(char *FileName, segmented_access SegMem, u32 AtOffset)
 {
     u32 Result = 0;
@@ -94,29 +143,14 @@ static segmented_access AllocateMemoryPow2(u32 SizePow2)
 }
 
 static void PrintEstimatedClocks(timing_state State, instruction Instruction, u32 SimFlags,
-                                 instruction_clock_interval *Accum)
+                                 instruction_clock_interval *Accum, FILE *Out)
 {
     instruction_timing Timing = EstimateInstructionClocks(State, Instruction);
     instruction_clock_interval Clocks = ExpectedClocksFrom(State, Instruction, Timing);
-    Accum->Min += Clocks.Min;
-    Accum->Max += Clocks.Max;
-    
-    if(Accum->Min != Accum->Max)
-    {
-        fprintf(stdout, "Clocks: +[%u,%u] = [%u,%u]", Clocks.Min, Clocks.Max, Accum->Min, Accum->Max);
-    }
-    else
-    {
-        fprintf(stdout, "Clocks: +%u = %u", Clocks.Min, Accum->Min);
-    }
-    
-    if(SimFlags & SimFlag_ExplainClocks)
-    {
-        ExplainTiming(Timing, Clocks, stdout);
-    }
+    PrintAccumulatedClocks(Timing, Clocks, (SimFlags & SimFlag_ExplainClocks), Accum, Out);
 }
 
-static void DisAsm8086(u32 DisAsmByteCount, segmented_access DisAsmStart, u32 SimFlags, timing_state Timing)
+static void DisAsm8086(u32 DisAsmByteCount, segmented_access DisAsmStart, u32 SimFlags, timing_state Timing, FILE *Out)
 {
     segmented_access At = DisAsmStart;
     
@@ -144,13 +178,13 @@ static void DisAsm8086(u32 DisAsmByteCount, segmented_access DisAsmStart, u32 Si
                 break;
             }
             
-            PrintInstruction(Instruction, stdout);
+            PrintInstruction(Instruction, Out);
             if(SimFlags & SimFlag_ShowClocks)
             {
-                printf(" ; ");
-                PrintEstimatedClocks(Timing, Instruction, SimFlags, &TimeAccum);
+                fprintf(Out, " ; ");
+                PrintEstimatedClocks(Timing, Instruction, SimFlags, &TimeAccum, Out);
             }
-            printf("\n");
+            fprintf(Out, "\n");
         }
         else
         {
@@ -160,174 +194,1472 @@ static void DisAsm8086(u32 DisAsmByteCount, segmented_access DisAsmStart, u32 Si
     }
 }
 
-static b32 IsRet(operation_type Op)
+static instruction DecodeStreamInstruction(instruction_table Table, segmented_access Window, u32 Offset, u64 Available)
 {
-    b32 Result = ((Op == Op_ret) ||
-                  (Op == Op_retf));
+    segmented_access At = Window;
+    SetSegmentBase(&At, (u16)(Offset >> 4));
+    At.SegmentOffset = (u16)(Offset & 0xf);
+    
+    // NOTE(agent): An instruction that would run past the end of the file is not an instruction.
+    instruction Result = DecodeInstruction(Table, At);
+    if(Result.Size > Available)
+    {
+        Result = {};
+    }
+    
     return Result;
 }
 
-static void Run8086(u32 OnePastLastByte, segmented_access MainMemory, u32 SimFlags, timing_state Timing)
+static void PrintStreamInstruction(instruction Instruction, u8 FirstByte, u32 SimFlags, timing_state Timing,
+                                   instruction_clock_interval *TimeAccum, FILE *Out)
 {
-    instruction_table Table = Get8086InstructionTable();
-    register_state_8086 Registers = {};
-    instruction_clock_interval TimeAccum = {};
-    
-    for(;;)
+    if(Instruction.Op)
     {
-        segmented_access At = MainMemory;
-        At.Mask = 0xffff;
-        At.SegmentBase = Registers.cs;
-        At.SegmentOffset = Registers.ip;
+        PrintInstruction(Instruction, Out);
+        if(SimFlags & SimFlag_ShowClocks)
+        {
+            fprintf(Out, " ; ");
+            PrintEstimatedClocks(Timing, Instruction, SimFlags, TimeAccum, Out);
+        }
+        fprintf(Out, "\n");
+    }
+    else
+    {
+        // NOTE(agent): Large files are rarely nothing but code, so rather than stopping at the
+        // first byte that isn't an instruction (as DisAsm8086 does), it is emitted as data, which
+        // still reassembles to the same file.
+        fprintf(Out, "db 0x%02x\n", FirstByte);
+    }
+}
+
+static void PrintStreamStats(u64 ByteCount, u64 InstructionCount, u64 UnrecognizedByteCount, u64 ElapsedTime)
+{
+    double Seconds = (double)ElapsedTime / (double)GetOSTimerFreq();
+    double Megabytes = (double)ByteCount / (1024.0*1024.0);
+    fprintf(stderr, "Stream: %llu bytes, %llu instructions, %llu unrecognized bytes\n",
+            ByteCount, InstructionCount, UnrecognizedByteCount);
+    fprintf(stderr, "Host: %.2f mb/second (%.6f seconds)\n", (Seconds > 0) ? (Megabytes / Seconds) : 0, Seconds);
+}
+
+static void StreamDisAsm8086(char *FileName, u32 SimFlags, timing_state Timing, FILE *Out)
+{
+    // NOTE(agent): Unlike DisAsm8086, this never loads the file into 8086 memory. It decodes it a chunk
+    // at a time instead, so it works on files of any size (firmware dumps, whole corpora concatenated
+    // together, etc.) without ever using more memory than one chunk.
+    FILE *File = fopen(FileName, "rb");
+    segmented_access Chunk = AllocateMemoryPow2(STREAM_CHUNK_SIZE_POW2);
+    if(File && IsValid(Chunk))
+    {
+        instruction_table Table = Get8086InstructionTable();
         
-        if(GetAbsoluteAddressOf(At) < OnePastLastByte)
+        Timing.AssumeBranchTaken = true;
+        instruction_clock_interval TimeAccum = {};
+        
+        // NOTE(agent): The decoder can look at up to MaxInstructionByteCount bytes of prefixes and then a
+        // whole instruction after them, so nothing is decoded until there are at least twice that many
+        // bytes left in the chunk (or the file has ended). That way an instruction that straddles two
+        // chunks is always decoded after the bytes at the end of the first chunk have been carried over
+        // to the start of the next one. The same number of bytes is kept free at the end of the chunk,
+        // and zeroed once the file ends, so the decoder never wraps around to bytes from earlier in the file.
+        u32 MinBytesToDecode = 2*Table.MaxInstructionByteCount;
+        u32 ChunkSize = GetHighestAddress(Chunk) + 1;
+        
+        u64 ByteCount = 0;
+        u64 InstructionCount = 0;
+        u64 UnrecognizedByteCount = 0;
+        
+        u32 ChunkAt = 0;
+        u32 ChunkEnd = 0;
+        b32 EndOfFile = false;
+        
+        u64 StartTime = ReadOSTimer();
+        for(;;)
         {
-            instruction Instruction = DecodeInstruction(Table, At);
-            if(Instruction.Op)
+            u32 Available = ChunkEnd - ChunkAt;
+            if(!EndOfFile && (Available < MinBytesToDecode))
             {
-                register_state_8086 PrevRegisters = Registers;
+                memmove(Chunk.Memory, Chunk.Memory + ChunkAt, Available);
+                ChunkAt = 0;
+                ChunkEnd = Available;
                 
-                if((SimFlags & SimFlag_StopOnRet) &&
-                   IsRet(Instruction.Op))
+                u32 MaxRead = ChunkSize - MinBytesToDecode - ChunkEnd;
+                u32 Read = (u32)fread(Chunk.Memory + ChunkEnd, 1, MaxRead, File);
+                ChunkEnd += Read;
+                ByteCount += Read;
+                EndOfFile = (Read < MaxRead);
+                if(EndOfFile)
                 {
-                    fprintf(stdout, "STOPONRET: Return encountered at address %u.\n", Instruction.Address);
-                    break;
+                    memset(Chunk.Memory + ChunkEnd, 0, MinBytesToDecode);
                 }
                 
-                Registers.ip += Instruction.Size;
-                exec_result Exec = ExecInstruction(MainMemory, &Registers, Instruction);
-                
-                if(!Exec.Unimplemented)
-                {
-                    PrintInstruction(Instruction, stdout);
-                    printf(" ; ");
-                    if(SimFlags & SimFlag_ShowClocks)
-                    {
-                        UpdateTimingForExec(&Timing, Exec);
-                        PrintEstimatedClocks(Timing, Instruction, SimFlags, &TimeAccum);
-                        fprintf(stdout, " | ");
-                    }
-                    if(!(SimFlags & SimFlag_NoRegisterDiffs))
-                    {
-                        PrintRegisterDifference(&PrevRegisters, &Registers, stdout);
-                    }
-                    printf("\n");
-                }
-                else
-                {
-                    printf("ERROR: Unimplemented instruction (%s).\n", GetMnemonic(Instruction.Op));
-                    break;
-                }
+                Available = ChunkEnd - ChunkAt;
+            }
+            
+            if(!Available)
+            {
+                break;
+            }
+            
+            instruction Instruction = DecodeStreamInstruction(Table, Chunk, ChunkAt, Available);
+            PrintStreamInstruction(Instruction, Chunk.Memory[ChunkAt], SimFlags, Timing, &TimeAccum, Out);
+            if(Instruction.Op)
+            {
+                ChunkAt += Instruction.Size;
+                ++InstructionCount;
             }
             else
             {
-                fprintf(stderr, "ERROR: Unrecognized binary in instruction stream.\n");
+                ChunkAt += 1;
+                ++UnrecognizedByteCount;
+            }
+        }
+        u64 ElapsedTime = ReadOSTimer() - StartTime;
+        
+        fflush(Out);
+        if(ferror(File))
+        {
+            fprintf(stderr, "ERROR: Unable to read all of %s.\n", FileName);
+        }
+        
+        PrintStreamStats(ByteCount, InstructionCount, UnrecognizedByteCount, ElapsedTime);
+    }
+    else if(!File)
+    {
+        fprintf(stderr, "ERROR: Unable to open %s.\n", FileName);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to allocate stream buffer.\n");
+    }
+    
+    if(File)
+    {
+        fclose(File);
+    }
+    if(IsValid(Chunk))
+    {
+        free(Chunk.Memory);
+    }
+}
+
+//
+// NOTE(agent): Parallel disassembly. Where an instruction starts depends on every instruction before
+// it, so a file can't just be cut into pieces that are disassembled independently. Instead, each
+// chunk is first swept speculatively from every offset the true instruction stream could enter it
+// at, recording only where each of those sweeps leaves the chunk. Once that is known for every chunk,
+// following the true stream from the start of the file is one lookup per chunk, and the chunks can
+// then be printed in parallel from their true entry points.
+//
+
+#define PARALLEL_DISASM_CHUNK_SIZE (256*1024)
+#define PARALLEL_DISASM_WINDOW_SIZE_POW2 19 // NOTE(agent): Must hold a chunk plus the bytes that can be decoded past its end
+#define MAX_DISASM_ENTRY_CANDIDATES 16
+
+struct disasm_chunk
+{
+    u64 Start;
+    u64 End;
+    
+    // NOTE(agent): ExitFor[N] is where a sweep that enters the chunk at Start+N leaves it, which is
+    // the offset of the first instruction at or past End. The true stream always enters a chunk
+    // within MaxInstructionByteCount bytes of its start, because that is the longest an instruction
+    // that started in the previous chunk can be.
+    u64 ExitFor[MAX_DISASM_ENTRY_CANDIDATES];
+    u64 Entry;
+    
+    u32 WorkerIndex;
+    long OutputStart;
+    long OutputEnd;
+    u64 InstructionCount;
+    u64 UnrecognizedByteCount;
+};
+
+struct parallel_disasm
+{
+    u8 *Data;
+    u64 Size;
+    instruction_table Table;
+    u32 SimFlags;
+    timing_state Timing;
+    
+    u32 ChunkCount;
+    disasm_chunk *Chunks;
+    
+    b32 PrintPass;
+    u32 volatile NextChunkIndex;
+};
+
+struct disasm_worker
+{
+    os_thread Thread;
+    b32 Started;
+    
+    parallel_disasm *Disasm;
+    u32 WorkerIndex;
+    FILE *Out;
+    
+    segmented_access Window;
+    u8 *SweepOf; // NOTE(agent): For each byte of the chunk, 1 + the candidate whose sweep decoded an instruction there
+};
+
+static void LoadDisasmWindow(parallel_disasm *Disasm, disasm_chunk *Chunk, segmented_access Window)
+{
+    // NOTE(agent): The window holds the chunk plus everything the decoder could read past its end.
+    // Past the end of the file it is zeroed, so what gets decoded never depends on what was left
+    // in the window by the previous chunk.
+    u32 LoadSize = (u32)(Chunk->End - Chunk->Start) + 2*Disasm->Table.MaxInstructionByteCount;
+    assert(LoadSize <= (GetHighestAddress(Window) + 1));
+    
+    u64 Available = Disasm->Size - Chunk->Start;
+    u32 CopySize = (Available < LoadSize) ? (u32)Available : LoadSize;
+    
+    memcpy(Window.Memory, Disasm->Data + Chunk->Start, CopySize);
+    memset(Window.Memory + CopySize, 0, LoadSize - CopySize);
+}
+
+static void SweepDisasmChunk(parallel_disasm *Disasm, disasm_chunk *Chunk, disasm_worker *Worker)
+{
+    instruction_table Table = Disasm->Table;
+    u32 ChunkSize = (u32)(Chunk->End - Chunk->Start);
+    memset(Worker->SweepOf, 0, ChunkSize);
+    
+    // NOTE(agent): The first chunk can only be entered at the start of the file.
+    u32 CandidateCount = (Chunk->Start == 0) ? 1 : Table.MaxInstructionByteCount;
+    for(u32 Candidate = 0; Candidate < CandidateCount; ++Candidate)
+    {
+        u32 Offset = Candidate;
+        u64 Exit = 0;
+        while(Offset < ChunkSize)
+        {
+            u32 SweepMark = Worker->SweepOf[Offset];
+            if(SweepMark)
+            {
+                // NOTE(agent): From here on, this sweep is the same as the earlier one that already
+                // decoded an instruction at this offset, so it leaves the chunk at the same place.
+                Exit = Chunk->ExitFor[SweepMark - 1];
                 break;
             }
+            Worker->SweepOf[Offset] = (u8)(Candidate + 1);
+            
+            instruction Instruction = DecodeStreamInstruction(Table, Worker->Window, Offset, Disasm->Size - (Chunk->Start + Offset));
+            Offset += Instruction.Op ? Instruction.Size : 1;
+        }
+        
+        Chunk->ExitFor[Candidate] = (Offset < ChunkSize) ? Exit : (Chunk->Start + Offset);
+    }
+}
+
+static void PrintDisasmChunk(parallel_disasm *Disasm, disasm_chunk *Chunk, disasm_worker *Worker)
+{
+    instruction_table Table = Disasm->Table;
+    instruction_clock_interval TimeAccum = {};
+    
+    u32 ChunkSize = (u32)(Chunk->End - Chunk->Start);
+    u32 Offset = (u32)(Chunk->Entry - Chunk->Start);
+    while(Offset < ChunkSize)
+    {
+        instruction Instruction = DecodeStreamInstruction(Table, Worker->Window, Offset, Disasm->Size - (Chunk->Start + Offset));
+        PrintStreamInstruction(Instruction, Worker->Window.Memory[Offset], Disasm->SimFlags, Disasm->Timing,
+                               &TimeAccum, Worker->Out);
+        if(Instruction.Op)
+        {
+            Offset += Instruction.Size;
+            ++Chunk->InstructionCount;
         }
         else
+        {
+            Offset += 1;
+            ++Chunk->UnrecognizedByteCount;
+        }
+    }
+}
+
+static void DisasmWorkerProc(void *Param)
+{
+    disasm_worker *Worker = (disasm_worker *)Param;
+    parallel_disasm *Disasm = Worker->Disasm;
+    
+    for(;;)
+    {
+        u32 ChunkIndex = AtomicIncrementU32(&Disasm->NextChunkIndex) - 1;
+        if(ChunkIndex >= Disasm->ChunkCount)
         {
             break;
         }
+        
+        disasm_chunk *Chunk = Disasm->Chunks + ChunkIndex;
+        LoadDisasmWindow(Disasm, Chunk, Worker->Window);
+        if(Disasm->PrintPass)
+        {
+            Chunk->WorkerIndex = Worker->WorkerIndex;
+            Chunk->OutputStart = ftell(Worker->Out);
+            PrintDisasmChunk(Disasm, Chunk, Worker);
+            fflush(Worker->Out);
+            Chunk->OutputEnd = ftell(Worker->Out);
+        }
+        else
+        {
+            SweepDisasmChunk(Disasm, Chunk, Worker);
+        }
+    }
+}
+
+static void RunDisasmWorkers(parallel_disasm *Disasm, disasm_worker *Workers, u32 WorkerCount)
+{
+    Disasm->NextChunkIndex = 0;
+    for(u32 WorkerIndex = 0; WorkerIndex < WorkerCount; ++WorkerIndex)
+    {
+        disasm_worker *Worker = Workers + WorkerIndex;
+        
+        // NOTE(agent): As with batch mode, the first worker always runs on this thread.
+        Worker->Started = (WorkerIndex > 0) && StartThread(&Worker->Thread, DisasmWorkerProc, Worker);
+    }
+    
+    for(u32 WorkerIndex = 0; WorkerIndex < WorkerCount; ++WorkerIndex)
+    {
+        if(!Workers[WorkerIndex].Started)
+        {
+            DisasmWorkerProc(Workers + WorkerIndex);
+        }
     }
     
-    printf("\n");
-    printf("Final registers:\n");
-    PrintRegisters(&Registers, stdout);
-    printf("\n");
+    for(u32 WorkerIndex = 0; WorkerIndex < WorkerCount; ++WorkerIndex)
+    {
+        if(Workers[WorkerIndex].Started)
+        {
+            WaitForThread(&Workers[WorkerIndex].Thread);
+        }
+    }
 }
 
-int main(int ArgCount, char **Args)
+static void ParallelDisAsm8086(char *FileName, u32 SimFlags, timing_state Timing, FILE *Out)
 {
-    b32 Execute = false;
-    u32 DumpIndex = 0;
-    u32 SimFlags = 0;
+    os_mapped_file File;
+    if((SimFlags & SimFlag_ShowClocks) || !MapFileForReading(&File, FileName))
+    {
+        // NOTE(agent): -showclocks prints a running total, which depends on every instruction before
+        // it, so that is only done by the serial path. So are files that can't be mapped, which
+        // includes empty ones.
+        StreamDisAsm8086(FileName, SimFlags, Timing, Out);
+        return;
+    }
     
-    timing_state Timing = {};
+    u64 StartTime = ReadOSTimer();
+    
+    parallel_disasm Disasm = {};
+    Disasm.Data = File.Data;
+    Disasm.Size = File.Size;
+    Disasm.Table = Get8086InstructionTable();
+    Disasm.SimFlags = SimFlags;
+    Disasm.Timing = Timing;
+    Disasm.Timing.AssumeBranchTaken = true;
+    assert(Disasm.Table.MaxInstructionByteCount <= MAX_DISASM_ENTRY_CANDIDATES);
+    
+    Disasm.ChunkCount = (u32)((File.Size + PARALLEL_DISASM_CHUNK_SIZE - 1) / PARALLEL_DISASM_CHUNK_SIZE);
+    Disasm.Chunks = (disasm_chunk *)calloc(Disasm.ChunkCount, sizeof(disasm_chunk));
     
-    u32 MainMemPow2 = 20;
-    u32 MainMemSize = (1 << MainMemPow2);
-    segmented_access MainMemory = AllocateMemoryPow2(MainMemPow2);
-    if(IsValid(MainMemory))
+    u32 WorkerCount = GetLogicalProcessorCount();
+    if(WorkerCount > Disasm.ChunkCount)
     {
-        if(ArgCount > 1)
+        WorkerCount = Disasm.ChunkCount;
+    }
+    
+    disasm_worker *Workers = (disasm_worker *)calloc(WorkerCount, sizeof(disasm_worker));
+    u32 ReadyCount = 0;
+    if(Disasm.Chunks && Workers)
+    {
+        for(u32 ChunkIndex = 0; ChunkIndex < Disasm.ChunkCount; ++ChunkIndex)
         {
-            for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+            disasm_chunk *Chunk = Disasm.Chunks + ChunkIndex;
+            Chunk->Start = (u64)ChunkIndex*PARALLEL_DISASM_CHUNK_SIZE;
+            Chunk->End = Chunk->Start + PARALLEL_DISASM_CHUNK_SIZE;
+            if(Chunk->End > File.Size)
             {
-                char *FileName = Args[ArgIndex];
-                
-                if(strcmp(FileName, "-exec") == 0)
-                {
-                    Execute = true;
-                }
-                else if(strcmp(FileName, "-showclocks") == 0)
-                {
-                    SimFlags |= SimFlag_ShowClocks;
-                }
-                else if(strcmp(FileName, "-explainclocks") == 0)
-                {
-                    SimFlags |= SimFlag_ShowClocks|SimFlag_ExplainClocks;
-                }
-                else if(strcmp(FileName, "-8088") == 0)
-                {
-                    Timing.Assume8088 = true;
-                }
-                else if(strcmp(FileName, "-disasm") == 0)
-                {
-                    Execute = false;
-                }
-                else if(strcmp(FileName, "-dump") == 0)
-                {
-                    SimFlags |= SimFlag_DumpMemory;
-                }
-                else if(strcmp(FileName, "-stoponret") == 0)
-                {
-                    SimFlags |= SimFlag_StopOnRet;
-                }
-                else
+                Chunk->End = File.Size;
+            }
+        }
+        
+        for(; ReadyCount < WorkerCount; ++ReadyCount)
+        {
+            disasm_worker *Worker = Workers + ReadyCount;
+            Worker->Disasm = &Disasm;
+            Worker->WorkerIndex = ReadyCount;
+            Worker->Out = tmpfile();
+            Worker->Window = AllocateMemoryPow2(PARALLEL_DISASM_WINDOW_SIZE_POW2);
+            Worker->SweepOf = (u8 *)malloc(PARALLEL_DISASM_CHUNK_SIZE);
+            if(!Worker->Out || !IsValid(Worker->Window) || !Worker->SweepOf)
+            {
+                break;
+            }
+        }
+    }
+    
+    if(ReadyCount)
+    {
+        RunDisasmWorkers(&Disasm, Workers, ReadyCount);
+        
+        u64 Entry = 0;
+        for(u32 ChunkIndex = 0; ChunkIndex < Disasm.ChunkCount; ++ChunkIndex)
+        {
+            disasm_chunk *Chunk = Disasm.Chunks + ChunkIndex;
+            assert((Entry - Chunk->Start) < Disasm.Table.MaxInstructionByteCount);
+            
+            Chunk->Entry = Entry;
+            Entry = Chunk->ExitFor[Entry - Chunk->Start];
+        }
+        
+        Disasm.PrintPass = true;
+        RunDisasmWorkers(&Disasm, Workers, ReadyCount);
+        
+        u64 InstructionCount = 0;
+        u64 UnrecognizedByteCount = 0;
+        char CopyBuffer[64*1024];
+        for(u32 ChunkIndex = 0; ChunkIndex < Disasm.ChunkCount; ++ChunkIndex)
+        {
+            disasm_chunk *Chunk = Disasm.Chunks + ChunkIndex;
+            InstructionCount += Chunk->InstructionCount;
+            UnrecognizedByteCount += Chunk->UnrecognizedByteCount;
+            
+            FILE *Source = Workers[Chunk->WorkerIndex].Out;
+            fseek(Source, Chunk->OutputStart, SEEK_SET);
+            long Remaining = Chunk->OutputEnd - Chunk->OutputStart;
+            while(Remaining > 0)
+            {
+                size_t ReadSize = (Remaining < (long)sizeof(CopyBuffer)) ? (size_t)Remaining : sizeof(CopyBuffer);
+                size_t BytesRead = fread(CopyBuffer, 1, ReadSize, Source);
+                if(BytesRead == 0)
                 {
-                    if(SimFlags & SimFlag_ShowClocks)
-                    {
-                        fprintf(stdout,
-                                "\n"
-                                "WARNING: Clocks reported by this utility are strictly from the 8086 manual.\n"
-                                "They will be inaccurate, both because the manual clocks are estimates, and because\n"
-                                "some of the entries in the manual look highly suspicious and are probably typos.\n"
-                                "\n");
-                    }
-                    
-                    u32 BytesRead = LoadMemoryFromFile(FileName, MainMemory, 0);
-                    if(Execute)
-                    {
-                        printf("--- %s execution ---\n", FileName);
-                        Run8086(BytesRead, MainMemory, SimFlags, Timing);
-                    }
-                    else
-                    {
-                        printf("; %s disassembly:\n", FileName);
-                        printf("bits 16\n");
-                        DisAsm8086(BytesRead, MainMemory, SimFlags, Timing);
-                    }
-                    
-                    if(SimFlags & SimFlag_DumpMemory)
-                    {
-                        char DumpFileName[256];
-                        sprintf(DumpFileName, "sim86_memory_%u.data", DumpIndex);
-                        FILE *DumpFile = fopen(DumpFileName, "wb");
-                        if(DumpFile)
-                        {
-                            fwrite(MainMemory.Memory, MainMemSize, 1, DumpFile);
-                            fclose(DumpFile);
-                        }
-                        
-                        ++DumpIndex;
-                    }
+                    fprintf(stderr, "ERROR: Lost disassembly output for %s.\n", FileName);
+                    break;
                 }
+                
+                fwrite(CopyBuffer, 1, BytesRead, Out);
+                Remaining -= (long)BytesRead;
+            }
+        }
+        u64 ElapsedTime = ReadOSTimer() - StartTime;
+        
+        fflush(Out);
+        PrintStreamStats(File.Size, InstructionCount, UnrecognizedByteCount, ElapsedTime);
+        fprintf(stderr, "Threads: %u, chunks: %u\n", ReadyCount, Disasm.ChunkCount);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to set up disassembly workers.\n");
+    }
+    
+    for(u32 WorkerIndex = 0; Workers && (WorkerIndex < WorkerCount); ++WorkerIndex)
+    {
+        disasm_worker *Worker = Workers + WorkerIndex;
+        if(Worker->Out)
+        {
+            fclose(Worker->Out);
+        }
+        if(IsValid(Worker->Window))
+        {
+            free(Worker->Window.Memory);
+        }
+        free(Worker->SweepOf);
+    }
+    free(Workers);
+    free(Disasm.Chunks);
+    
+    UnmapFile(&File);
+}
+
+static b32 IsRet(operation_type Op)
+{
+    b32 Result = ((Op == Op_ret) ||
+                  (Op == Op_retf));
+    return Result;
+}
+
+static instruction_clock_interval ClocksForExec(timing_state Timing, instruction Instruction, instruction_timing InstTiming,
+                                                bus_state *Bus, register_state_8086 *Registers)
+{
+    instruction_clock_interval Result;
+    if(Bus)
+    {
+        u32 NextAddress = GetAbsoluteAddressOf(0xffff, Registers->cs, Registers->ip, 0);
+        Result = SimulateBusClocks(Bus, Timing, Instruction, InstTiming, NextAddress);
+    }
+    else
+    {
+        Result = ExpectedClocksFrom(Timing, Instruction, InstTiming);
+    }
+    
+    return Result;
+}
+
+static void PrintRunStats(u64 InstructionCount, u64 ElapsedTime, instruction_clock_interval *Clocks, FILE *Out)
+{
+    double Seconds = (double)ElapsedTime / (double)GetOSTimerFreq();
+    
+    fprintf(Out, "Instructions: %llu\n", InstructionCount);
+    if(Clocks)
+    {
+        fprintf(Out, "Estimated clocks: ");
+        PrintClockInterval(*Clocks, Out);
+        fprintf(Out, "\n");
+    }
+    fprintf(Out, "Host: %.0f instructions/second (%.6f seconds)\n", (Seconds > 0) ? (InstructionCount / Seconds) : 0, Seconds);
+    fprintf(Out, "\n");
+}
+
+static void Run8086(snapshot_state Start, segmented_access MainMemory, u32 SimFlags, decode_cache *Cache,
+                    trace_writer *Trace, record_writer *Records, profiler *Profile, snapshot_request *Snapshot,
+                    FILE *Out)
+{
+    instruction_table Table = Get8086InstructionTable();
+    u32 OnePastLastByte = Start.ProgramSize;
+    register_state_8086 Registers = Start.Registers;
+    timing_state Timing = Start.Timing;
+    instruction_clock_interval TimeAccum = {};
+    u64 InstructionCount = 0;
+    
+    // NOTE(agent): With -busclocks, clocks come from simulating the prefetch queue and the bus across
+    // the whole run rather than from the manual numbers for each instruction on its own.
+    bus_state BusState;
+    bus_state *Bus = 0;
+    if(SimFlags & SimFlag_BusClocks)
+    {
+        Bus = &BusState;
+        ResetBusState(Bus, Timing.Assume8088, GetAbsoluteAddressOf(0xffff, Registers.cs, Registers.ip, 0));
+    }
+    
+    if(Profile)
+    {
+        ResetProfiler(Profile, GetAbsoluteAddressOf(0xffff, Registers.cs, Registers.ip, 0));
+    }
+    
+    // NOTE(agent): In quiet mode nothing is printed per instruction, and the registers are not
+    // copied for diffing. Clocks are still estimated, but only the total is reported.
+    b32 Quiet = (SimFlags & SimFlag_Quiet);
+    
+    // NOTE(agent): When tracing, the per-instruction output goes to the trace as binary records instead
+    // of being printed, and sim86_tracetext turns it back into the text that would have been printed.
+    if(Quiet)
+    {
+        Trace = 0;
+    }
+    
+    if(Trace)
+    {
+        TraceRegisters(Trace, &Registers);
+    }
+    
+    if(Cache)
+    {
+        // NOTE(agent): The cache has to start empty for every run, since the memory it was built
+        // from has been reloaded. Once it is attached to main memory, every write the simulation
+        // makes into cached code invalidates the affected entries.
+        ResetDecodeCache(Cache);
+        MainMemory.Tracker = &Cache->Tracker;
+    }
+    
+    u64 StartTime = ReadOSTimer();
+    for(;;)
+    {
+        segmented_access At = MainMemory;
+        At.Mask = 0xffff;
+        SetSegmentBase(&At, Registers.cs);
+        At.SegmentOffset = Registers.ip;
+        
+        if(GetAbsoluteAddressOf(At) < OnePastLastByte)
+        {
+            instruction Instruction = Cache ? DecodeInstructionCached(Cache, Table, At) : DecodeInstruction(Table, At);
+            if(Instruction.Op)
+            {
+                register_state_8086 PrevRegisters;
+                if(!Quiet || Records)
+                {
+                    PrevRegisters = Registers;
+                }
+                
+                if((SimFlags & SimFlag_StopOnRet) &&
+                   IsRet(Instruction.Op))
+                {
+                    if(Trace)
+                    {
+                        TraceStopOnRet(Trace, Instruction.Address);
+                    }
+                    else
+                    {
+                        fprintf(Out, "STOPONRET: Return encountered at address %u.\n", Instruction.Address);
+                    }
+                    break;
+                }
+                
+                // NOTE(agent): The instruction bytes have to be captured before executing, since the
+                // instruction may overwrite itself.
+                u8 InstructionBytes[16];
+                if(Trace)
+                {
+                    for(u32 ByteIndex = 0; ByteIndex < Instruction.Size; ++ByteIndex)
+                    {
+                        InstructionBytes[ByteIndex] = *AccessMemory(At, ByteIndex);
+                    }
+                }
+                
+                Registers.ip += Instruction.Size;
+                exec_result Exec = ExecInstruction(MainMemory, &Registers, Instruction);
+                if(Cache)
+                {
+                    InvalidateWrittenCode(Cache, Table);
+                }
+                
+                if(Exec.Unimplemented)
+                {
+                    if(Trace)
+                    {
+                        TraceUnimplemented(Trace, Instruction.Op);
+                    }
+                    else
+                    {
+                        fprintf(Out, "ERROR: Unimplemented instruction (%s).\n", GetMnemonic(Instruction.Op));
+                    }
+                    break;
+                }
+                
+                ++InstructionCount;
+                
+                instruction_timing InstTiming = {};
+                instruction_clock_interval Clocks = {};
+                if(Quiet || Profile || Records || (SimFlags & SimFlag_ShowClocks))
+                {
+                    UpdateTimingForExec(&Timing, Exec);
+                    InstTiming = EstimateInstructionClocks(Timing, Instruction);
+                    Clocks = ClocksForExec(Timing, Instruction, InstTiming, Bus, &Registers);
+                }
+                
+                if(Snapshot && (InstructionCount == Snapshot->AtInstructionCount))
+                {
+                    snapshot_state State = {};
+                    State.ProgramSize = OnePastLastByte;
+                    State.Registers = Registers;
+                    State.Timing = Timing;
+                    
+                    FILE *SnapshotFile = fopen(Snapshot->FileName, "wb");
+                    if(!SnapshotFile || !WriteSnapshot(SnapshotFile, &State, MainMemory))
+                    {
+                        fprintf(stderr, "ERROR: Unable to write %s.\n", Snapshot->FileName);
+                    }
+                    if(SnapshotFile)
+                    {
+                        fclose(SnapshotFile);
+                    }
+                }
+                
+                if(Records)
+                {
+                    WriteInstructionRecord(Records, Instruction, &PrevRegisters, &Registers, InstTiming, Clocks);
+                }
+                
+                if(Profile)
+                {
+                    // NOTE(agent): Where the manual gives a range, the profile counts the minimum.
+                    ProfileInstruction(Profile, Instruction, Clocks.Min,
+                                       GetAbsoluteAddressOf(0xffff, Registers.cs, Registers.ip, 0));
+                }
+                
+                if(Quiet)
+                {
+                    TimeAccum.Min += Clocks.Min;
+                    TimeAccum.Max += Clocks.Max;
+                }
+                else if(Trace)
+                {
+                    TraceInstruction(Trace, InstructionBytes, Instruction, &PrevRegisters, &Registers, InstTiming, Clocks);
+                }
+                else
+                {
+                    PrintInstruction(Instruction, Out);
+                    fprintf(Out, " ; ");
+                    if(SimFlags & SimFlag_ShowClocks)
+                    {
+                        PrintAccumulatedClocks(InstTiming, Clocks, (SimFlags & SimFlag_ExplainClocks), &TimeAccum, Out);
+                        fprintf(Out, " | ");
+                    }
+                    if(!(SimFlags & SimFlag_NoRegisterDiffs))
+                    {
+                        PrintRegisterDifference(&PrevRegisters, &Registers, Out);
+                    }
+                    fprintf(Out, "\n");
+                }
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: Unrecognized binary in instruction stream.\n");
+                break;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+    
+    u64 ElapsedTime = ReadOSTimer() - StartTime;
+    
+    if(Trace)
+    {
+        TraceRegisters(Trace, &Registers);
+        EndTrace(Trace);
+        if(Trace->WriteFailed)
+        {
+            fprintf(stderr, "ERROR: Unable to write trace.\n");
+        }
+    }
+    
+    if(Records)
+    {
+        EndRecords(Records);
+        if(Records->WriteFailed)
+        {
+            fprintf(stderr, "ERROR: Unable to write records.\n");
+        }
+    }
+    
+    PrintFinalRegisters(&Registers, Out);
+    if(Quiet)
+    {
+        PrintRunStats(InstructionCount, ElapsedTime, &TimeAccum, Out);
+    }
+    
+    if(Profile)
+    {
+        PrintProfile(Profile, Table, MainMemory, Out);
+    }
+    
+    if(Cache && (SimFlags & SimFlag_ShowCacheStats))
+    {
+        fprintf(Out, "Decode cache: %llu hits, %llu misses, %llu invalidations\n\n",
+               Cache->Hits, Cache->Misses, Cache->Invalidations);
+    }
+}
+
+static void Run8086Blocks(snapshot_state Start, segmented_access MainMemory, u32 SimFlags, block_machine *Machine,
+                          FILE *Out)
+{
+    // NOTE(agent): The block executor does not print anything per instruction, since the whole point
+    // of it is to avoid doing per-instruction work. It produces the same final state as Run8086.
+    instruction_table Table = Get8086InstructionTable();
+    
+    ResetBlockMachine(Machine, MainMemory, (SimFlags & SimFlag_StopOnRet));
+    Machine->Registers = Start.Registers;
+    
+    u64 StartTime = ReadOSTimer();
+    RunBlocks(Machine, Table, Start.ProgramSize, Out);
+    u64 ElapsedTime = ReadOSTimer() - StartTime;
+    
+    PrintFinalRegisters(&Machine->Registers, Out);
+    if(SimFlags & SimFlag_Quiet)
+    {
+        // NOTE(agent): The block executor does not estimate clocks, so only the counts are reported.
+        PrintRunStats(Machine->InstructionCount, ElapsedTime, 0, Out);
+    }
+}
+
+// NOTE(agent): Everything one simulated 8086 needs to process files. Normally there is only one of
+// these, but in batch mode each worker thread gets its own, so nothing is shared between them.
+struct sim_context
+{
+    segmented_access MainMemory;
+    decode_cache *Cache;
+    block_machine *BlockMachine;
+    u8 *TraceBuffer;
+    char *RecordBuffer;
+    profiler *Profile;
+    
+    // NOTE(agent): Records which pages a run wrote when neither the decode cache nor the block
+    // executor (which have trackers of their own) is in use.
+    memory_tracker Tracker;
+};
+
+struct sim_job
+{
+    char *FileName;
+    b32 Execute;
+    u32 SimFlags;
+    timing_state Timing;
+    u32 DumpIndex;
+    u32 TraceIndex;
+    u32 RecordsIndex;
+    u32 StacksIndex;
+    u32 SnapshotIndex;
+    u64 SnapshotAt;
+    
+    // NOTE(agent): In batch mode, this is where the output for the job ended up
+    u32 WorkerIndex;
+    long OutputStart;
+    long OutputEnd;
+};
+
+struct batch_worker
+{
+    os_thread Thread;
+    b32 Started;
+    
+    sim_context Context;
+    FILE *Out;
+    u32 WorkerIndex;
+    
+    sim_job *Jobs;
+    u32 JobCount;
+    u32 volatile *NextJobIndex;
+};
+
+#define MAIN_MEMORY_SIZE_POW2 20
+
+static b32 InitSimContext(sim_context *Context)
+{
+    *Context = {};
+    Context->MainMemory = AllocateMemoryPow2(MAIN_MEMORY_SIZE_POW2);
+    Context->Cache = (decode_cache *)malloc(sizeof(decode_cache));
+    
+    b32 Result = IsValid(Context->MainMemory);
+    return Result;
+}
+
+static void FreeSimContext(sim_context *Context)
+{
+    if(IsValid(Context->MainMemory))
+    {
+        free(Context->MainMemory.Memory);
+    }
+    free(Context->Cache);
+    free(Context->BlockMachine);
+    free(Context->TraceBuffer);
+    free(Context->RecordBuffer);
+    free(Context->Profile);
+    
+    *Context = {};
+}
+
+static void ProcessFile(sim_context *Context, sim_job *Job, FILE *Out)
+{
+    char *FileName = Job->FileName;
+    u32 SimFlags = Job->SimFlags;
+    segmented_access MainMemory = Context->MainMemory;
+    
+    if(SimFlags & SimFlag_ShowClocks)
+    {
+        PrintClocksWarning(Out);
+    }
+    
+    ClearMemoryTracker(&Context->Tracker);
+    MainMemory.Tracker = &Context->Tracker;
+    memory_tracker *DirtyTracker = &Context->Tracker;
+    
+    snapshot_state Start = {};
+    Start.Timing = Job->Timing;
+    if(SimFlags & SimFlag_Resume)
+    {
+        // NOTE(agent): The snapshot is only mapped for as long as it takes to copy the pages it stores
+        // into main memory, which is all a restore has to do.
+        os_mapped_file SnapshotFile;
+        if(MapFileForReading(&SnapshotFile, FileName))
+        {
+            if(RestoreSnapshot(SnapshotFile.Data, SnapshotFile.Size, MainMemory, &Start))
+            {
+                Start.Timing.Assume8088 |= Job->Timing.Assume8088;
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: %s is not a sim86 snapshot.\n", FileName);
+            }
+            
+            UnmapFile(&SnapshotFile);
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Unable to open %s.\n", FileName);
+        }
+    }
+    else if(!(SimFlags & SimFlag_Stream))
+    {
+        Start.ProgramSize = LoadMemoryFromFile(FileName, MainMemory, 0);
+    }
+    
+    if(Job->Execute)
+    {
+        fprintf(Out, "--- %s execution ---\n", FileName);
+        if(SimFlags & SimFlag_BlockExec)
+        {
+            if(!Context->BlockMachine)
+            {
+                Context->BlockMachine = (block_machine *)malloc(sizeof(block_machine));
+            }
+            
+            if(Context->BlockMachine)
+            {
+                Run8086Blocks(Start, MainMemory, SimFlags, Context->BlockMachine, Out);
+                DirtyTracker = &Context->BlockMachine->Tracker;
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: Unable to allocate block executor.\n");
+            }
+        }
+        else
+        {
+            b32 UseCache = (Context->Cache && !(SimFlags & SimFlag_NoDecodeCache));
+            
+            FILE *TraceFile = 0;
+            trace_writer Trace = {};
+            if(SimFlags & SimFlag_Trace)
+            {
+                if(!Context->TraceBuffer)
+                {
+                    Context->TraceBuffer = (u8 *)malloc(TRACE_BUFFER_SIZE);
+                }
+                
+                char TraceFileName[256];
+                sprintf(TraceFileName, "sim86_trace_%u.data", Job->TraceIndex);
+                TraceFile = Context->TraceBuffer ? fopen(TraceFileName, "wb") : 0;
+                if(TraceFile)
+                {
+                    u32 TraceFlags = 0;
+                    if(SimFlags & SimFlag_ShowClocks) {TraceFlags |= TraceFlag_ShowClocks;}
+                    if(SimFlags & SimFlag_ExplainClocks) {TraceFlags |= TraceFlag_ExplainClocks;}
+                    if(SimFlags & SimFlag_NoRegisterDiffs) {TraceFlags |= TraceFlag_NoRegisterDiffs;}
+                    
+                    Trace = BeginTrace(TraceFile, Context->TraceBuffer, TRACE_BUFFER_SIZE, TraceFlags, FileName);
+                }
+                else
+                {
+                    fprintf(stderr, "ERROR: Unable to open %s.\n", TraceFileName);
+                }
+            }
+            
+            FILE *RecordsFile = 0;
+            record_writer Records = {};
+            if(SimFlags & (SimFlag_JSONRecords|SimFlag_CSVRecords))
+            {
+                if(!Context->RecordBuffer)
+                {
+                    Context->RecordBuffer = (char *)malloc(RECORD_BUFFER_SIZE);
+                }
+                
+                b32 CSV = (SimFlags & SimFlag_CSVRecords);
+                char RecordsFileName[256];
+                sprintf(RecordsFileName, "sim86_records_%u.%s", Job->RecordsIndex, CSV ? "csv" : "jsonl");
+                RecordsFile = Context->RecordBuffer ? fopen(RecordsFileName, "wb") : 0;
+                if(RecordsFile)
+                {
+                    Records = BeginRecords(RecordsFile, Context->RecordBuffer, RECORD_BUFFER_SIZE,
+                                           CSV ? RecordFormat_CSV : RecordFormat_JSONLines);
+                }
+                else
+                {
+                    fprintf(stderr, "ERROR: Unable to open %s.\n", RecordsFileName);
+                }
+            }
+            
+            if((SimFlags & SimFlag_Profile) && !Context->Profile)
+            {
+                Context->Profile = (profiler *)malloc(sizeof(profiler));
+                if(!Context->Profile)
+                {
+                    fprintf(stderr, "ERROR: Unable to allocate profiler.\n");
+                }
+            }
+            profiler *Profile = (SimFlags & SimFlag_Profile) ? Context->Profile : 0;
+            
+            char SnapshotFileName[256];
+            snapshot_request Snapshot = {};
+            if(SimFlags & SimFlag_Snapshot)
+            {
+                sprintf(SnapshotFileName, "sim86_snapshot_%u.data", Job->SnapshotIndex);
+                Snapshot.FileName = SnapshotFileName;
+                Snapshot.AtInstructionCount = Job->SnapshotAt;
+            }
+            
+            Run8086(Start, MainMemory, SimFlags, UseCache ? Context->Cache : 0, TraceFile ? &Trace : 0,
+                    RecordsFile ? &Records : 0, Profile, (SimFlags & SimFlag_Snapshot) ? &Snapshot : 0, Out);
+            if(UseCache)
+            {
+                DirtyTracker = &Context->Cache->Tracker;
+            }
+            
+            if(TraceFile)
+            {
+                fclose(TraceFile);
+            }
+            
+            if(RecordsFile)
+            {
+                fclose(RecordsFile);
+            }
+            
+            if(Profile && (SimFlags & SimFlag_FoldedStacks))
+            {
+                char StacksFileName[256];
+                sprintf(StacksFileName, "sim86_stacks_%u.folded", Job->StacksIndex);
+                FILE *StacksFile = fopen(StacksFileName, "wb");
+                if(StacksFile)
+                {
+                    WriteFoldedStacks(Profile, FileName, StacksFile);
+                    fclose(StacksFile);
+                }
+                else
+                {
+                    fprintf(stderr, "ERROR: Unable to open %s.\n", StacksFileName);
+                }
+            }
+        }
+    }
+    else
+    {
+        fprintf(Out, "; %s disassembly:\n", FileName);
+        fprintf(Out, "bits 16\n");
+        if(SimFlags & SimFlag_Parallel)
+        {
+            ParallelDisAsm8086(FileName, SimFlags, Start.Timing, Out);
+        }
+        else if(SimFlags & SimFlag_Stream)
+        {
+            StreamDisAsm8086(FileName, SimFlags, Start.Timing, Out);
+        }
+        else
+        {
+            DisAsm8086(Start.ProgramSize, MainMemory, SimFlags, Start.Timing, Out);
+        }
+    }
+    
+    if(SimFlags & SimFlag_DumpMemory)
+    {
+        char DumpFileName[256];
+        sprintf(DumpFileName, "sim86_memory_%u.data", Job->DumpIndex);
+        FILE *DumpFile = fopen(DumpFileName, "wb");
+        if(DumpFile)
+        {
+            fwrite(MainMemory.Memory, GetHighestAddress(MainMemory) + 1, 1, DumpFile);
+            fclose(DumpFile);
+        }
+    }
+    
+    if(SimFlags & SimFlag_DumpPages)
+    {
+        char DumpFileName[256];
+        sprintf(DumpFileName, "sim86_memory_%u.pages", Job->DumpIndex);
+        FILE *DumpFile = fopen(DumpFileName, "wb");
+        if(!DumpFile || !WriteDirtyPages(DumpFile, DirtyTracker, MainMemory))
+        {
+            fprintf(stderr, "ERROR: Unable to write %s.\n", DumpFileName);
+        }
+        if(DumpFile)
+        {
+            fclose(DumpFile);
+        }
+    }
+}
+
+static void BatchWorkerProc(void *Param)
+{
+    batch_worker *Worker = (batch_worker *)Param;
+    segmented_access MainMemory = Worker->Context.MainMemory;
+    
+    for(;;)
+    {
+        u32 JobIndex = AtomicIncrementU32(Worker->NextJobIndex) - 1;
+        if(JobIndex >= Worker->JobCount)
+        {
+            break;
+        }
+        
+        // NOTE(agent): Unlike the one-file-at-a-time path, memory is cleared before every image, so
+        // that the output for an image never depends on which images happened to run before it
+        // on the same worker.
+        memset(MainMemory.Memory, 0, GetHighestAddress(MainMemory) + 1);
+        
+        sim_job *Job = Worker->Jobs + JobIndex;
+        Job->WorkerIndex = Worker->WorkerIndex;
+        Job->OutputStart = ftell(Worker->Out);
+        ProcessFile(&Worker->Context, Job, Worker->Out);
+        fflush(Worker->Out);
+        Job->OutputEnd = ftell(Worker->Out);
+    }
+}
+
+static void RunBatch(sim_context *MainContext, u32 JobCount, sim_job *Jobs)
+{
+    // NOTE(agent): Each worker writes the output for its jobs into its own temporary file. Once every
+    // job is done, the output is copied to stdout in the order the jobs were given, so the result
+    // is the same no matter how the jobs were spread across the workers.
+    u32 WorkerCount = GetLogicalProcessorCount();
+    if(WorkerCount > JobCount)
+    {
+        WorkerCount = JobCount;
+    }
+    
+    batch_worker *Workers = (batch_worker *)calloc(WorkerCount, sizeof(batch_worker));
+    u32 ReadyCount = 0;
+    if(Workers)
+    {
+        for(; ReadyCount < WorkerCount; ++ReadyCount)
+        {
+            batch_worker *Worker = Workers + ReadyCount;
+            Worker->Out = tmpfile();
+            if(!Worker->Out || !InitSimContext(&Worker->Context))
+            {
+                if(Worker->Out)
+                {
+                    fclose(Worker->Out);
+                }
+                FreeSimContext(&Worker->Context);
+                break;
+            }
+        }
+    }
+    
+    if(ReadyCount)
+    {
+        u32 volatile NextJobIndex = 0;
+        for(u32 WorkerIndex = 0; WorkerIndex < ReadyCount; ++WorkerIndex)
+        {
+            batch_worker *Worker = Workers + WorkerIndex;
+            Worker->WorkerIndex = WorkerIndex;
+            Worker->Jobs = Jobs;
+            Worker->JobCount = JobCount;
+            Worker->NextJobIndex = &NextJobIndex;
+            
+            // NOTE(agent): The first worker always runs on this thread, which also covers the case
+            // where threads cannot be started at all.
+            Worker->Started = (WorkerIndex > 0) && StartThread(&Worker->Thread, BatchWorkerProc, Worker);
+        }
+        
+        for(u32 WorkerIndex = 0; WorkerIndex < ReadyCount; ++WorkerIndex)
+        {
+            if(!Workers[WorkerIndex].Started)
+            {
+                BatchWorkerProc(Workers + WorkerIndex);
+            }
+        }
+        
+        for(u32 WorkerIndex = 0; WorkerIndex < ReadyCount; ++WorkerIndex)
+        {
+            if(Workers[WorkerIndex].Started)
+            {
+                WaitForThread(&Workers[WorkerIndex].Thread);
+            }
+        }
+        
+        char CopyBuffer[64*1024];
+        for(u32 JobIndex = 0; JobIndex < JobCount; ++JobIndex)
+        {
+            sim_job *Job = Jobs + JobIndex;
+            FILE *Source = Workers[Job->WorkerIndex].Out;
+            
+            fseek(Source, Job->OutputStart, SEEK_SET);
+            long Remaining = Job->OutputEnd - Job->OutputStart;
+            while(Remaining > 0)
+            {
+                size_t ReadSize = (Remaining < (long)sizeof(CopyBuffer)) ? (size_t)Remaining : sizeof(CopyBuffer);
+                size_t BytesRead = fread(CopyBuffer, 1, ReadSize, Source);
+                if(BytesRead == 0)
+                {
+                    fprintf(stderr, "ERROR: Lost batch output for %s.\n", Job->FileName);
+                    break;
+                }
+                
+                fwrite(CopyBuffer, 1, BytesRead, stdout);
+                Remaining -= (long)BytesRead;
+            }
+        }
+        
+        for(u32 WorkerIndex = 0; WorkerIndex < ReadyCount; ++WorkerIndex)
+        {
+            fclose(Workers[WorkerIndex].Out);
+            FreeSimContext(&Workers[WorkerIndex].Context);
+        }
+    }
+    else
+    {
+        fprintf(stderr, "WARNING: Unable to set up batch workers, running the batch one file at a time.\n");
+        for(u32 JobIndex = 0; JobIndex < JobCount; ++JobIndex)
+        {
+            ProcessFile(MainContext, Jobs + JobIndex, stdout);
+        }
+    }
+    
+    free(Workers);
+}
+
+static char *ReadEntireFile(char *FileName)
+{
+    char *Result = 0;
+    
+    FILE *File = fopen(FileName, "rb");
+    if(File)
+    {
+        fseek(File, 0, SEEK_END);
+        long Size = ftell(File);
+        fseek(File, 0, SEEK_SET);
+        
+        Result = (Size >= 0) ? (char *)malloc(Size + 1) : 0;
+        if(Result)
+        {
+            Size = (long)fread(Result, 1, Size, File);
+            Result[Size] = 0;
+        }
+        
+        fclose(File);
+    }
+    
+    return Result;
+}
+
+int main(int ArgCount, char **Args)
+{
+    b32 Execute = false;
+    b32 Batch = false;
+    u32 DumpIndex = 0;
+    u32 TraceIndex = 0;
+    u32 RecordsIndex = 0;
+    u32 StacksIndex = 0;
+    u32 SnapshotIndex = 0;
+    u64 SnapshotAt = 0;
+    u32 SimFlags = 0;
+    
+    timing_state Timing = {};
+    
+    u32 JobCount = 0;
+    u32 MaxJobCount = 0;
+    sim_job *Jobs = 0;
+    
+    // NOTE(agent): The output buffer has to be set up before anything is written to stdout, so -stream
+    // and -parallel are checked for before any of the files are processed.
+    for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+    {
+        if((strcmp(Args[ArgIndex], "-stream") == 0) ||
+           (strcmp(Args[ArgIndex], "-parallel") == 0))
+        {
+            setvbuf(stdout, 0, _IOFBF, STREAM_OUTPUT_BUFFER_SIZE);
+            break;
+        }
+    }
+    
+    sim_context Context;
+    if(InitSimContext(&Context))
+    {
+        if(ArgCount > 1)
+        {
+            for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+            {
+                char *FileName = Args[ArgIndex];
+                
+                if(strcmp(FileName, "-exec") == 0)
+                {
+                    Execute = true;
+                }
+                else if(strcmp(FileName, "-showclocks") == 0)
+                {
+                    SimFlags |= SimFlag_ShowClocks;
+                }
+                else if(strcmp(FileName, "-explainclocks") == 0)
+                {
+                    SimFlags |= SimFlag_ShowClocks|SimFlag_ExplainClocks;
+                }
+                else if(strcmp(FileName, "-busclocks") == 0)
+                {
+                    SimFlags |= SimFlag_ShowClocks|SimFlag_BusClocks;
+                }
+                else if(strcmp(FileName, "-8088") == 0)
+                {
+                    Timing.Assume8088 = true;
+                }
+                else if(strcmp(FileName, "-disasm") == 0)
+                {
+                    Execute = false;
+                }
+                else if(strcmp(FileName, "-stream") == 0)
+                {
+                    Execute = false;
+                    SimFlags |= SimFlag_Stream;
+                }
+                else if(strcmp(FileName, "-parallel") == 0)
+                {
+                    Execute = false;
+                    SimFlags |= SimFlag_Stream|SimFlag_Parallel;
+                }
+                else if(strcmp(FileName, "-dump") == 0)
+                {
+                    SimFlags |= SimFlag_DumpMemory;
+                }
+                else if(strcmp(FileName, "-dumppages") == 0)
+                {
+                    SimFlags |= SimFlag_DumpPages;
+                }
+                else if(strcmp(FileName, "-stoponret") == 0)
+                {
+                    SimFlags |= SimFlag_StopOnRet;
+                }
+                else if(strcmp(FileName, "-nocache") == 0)
+                {
+                    SimFlags |= SimFlag_NoDecodeCache;
+                }
+                else if(strcmp(FileName, "-cachestats") == 0)
+                {
+                    SimFlags |= SimFlag_ShowCacheStats;
+                }
+                else if((strcmp(FileName, "-quiet") == 0) ||
+                        (strcmp(FileName, "-bench") == 0))
+                {
+                    Execute = true;
+                    SimFlags |= SimFlag_Quiet;
+                }
+                else if(strcmp(FileName, "-blocks") == 0)
+                {
+                    Execute = true;
+                    SimFlags |= SimFlag_BlockExec;
+                }
+                else if(strcmp(FileName, "-trace") == 0)
+                {
+                    Execute = true;
+                    SimFlags |= SimFlag_Trace;
+                }
+                else if(strcmp(FileName, "-json") == 0)
+                {
+                    Execute = true;
+                    SimFlags &= ~SimFlag_CSVRecords;
+                    SimFlags |= SimFlag_JSONRecords;
+                }
+                else if(strcmp(FileName, "-csv") == 0)
+                {
+                    Execute = true;
+                    SimFlags &= ~SimFlag_JSONRecords;
+                    SimFlags |= SimFlag_CSVRecords;
+                }
+                else if(strcmp(FileName, "-profile") == 0)
+                {
+                    Execute = true;
+                    SimFlags |= SimFlag_Profile;
+                }
+                else if(strcmp(FileName, "-stacks") == 0)
+                {
+                    Execute = true;
+                    SimFlags |= SimFlag_Profile|SimFlag_FoldedStacks;
+                }
+                else if((strcmp(FileName, "-snapshot") == 0) && ((ArgIndex + 1) < ArgCount))
+                {
+                    Execute = true;
+                    SimFlags |= SimFlag_Snapshot;
+                    SnapshotAt = strtoull(Args[++ArgIndex], 0, 10);
+                }
+                else if(strcmp(FileName, "-resume") == 0)
+                {
+                    Execute = true;
+                    SimFlags |= SimFlag_Resume;
+                }
+                else if(strcmp(FileName, "-batch") == 0)
+                {
+                    Batch = true;
+                }
+                else
+                {
+                    // NOTE(agent): -stream and -parallel only disassemble, and never load the file into
+                    // memory. So when a later switch (like -exec or -quiet) turns execution back on,
+                    // they no longer apply, or the file would execute as an empty program.
+                    if(Execute)
+                    {
+                        SimFlags &= ~(SimFlag_Stream|SimFlag_Parallel);
+                    }
+                    
+                    // NOTE(agent): In batch mode, "@listfile" adds every line of listfile as an image,
+                    // since a regression corpus can be far too large for a command line.
+                    char *ListFile = 0;
+                    if(Batch && (FileName[0] == '@'))
+                    {
+                        ListFile = ReadEntireFile(FileName + 1);
+                        if(!ListFile)
+                        {
+                            fprintf(stderr, "ERROR: Unable to open %s.\n", FileName + 1);
+                            continue;
+                        }
+                    }
+                    
+                    char *NextName = ListFile;
+                    do
+                    {
+                        if(ListFile)
+                        {
+                            FileName = NextName;
+                            while(*NextName && (*NextName != '\n') && (*NextName != '\r'))
+                            {
+                                ++NextName;
+                            }
+                            while((*NextName == '\n') || (*NextName == '\r'))
+                            {
+                                *NextName++ = 0;
+                            }
+                            
+                            if(!*FileName)
+                            {
+                                continue;
+                            }
+                        }
+                        
+                        sim_job Job = {};
+                        Job.FileName = FileName;
+                        Job.Execute = Execute;
+                        Job.SimFlags = SimFlags;
+                        Job.Timing = Timing;
+                        if(SimFlags & (SimFlag_DumpMemory|SimFlag_DumpPages))
+                        {
+                            Job.DumpIndex = DumpIndex++;
+                        }
+                        if(Execute && (SimFlags & SimFlag_Trace) && !(SimFlags & SimFlag_BlockExec))
+                        {
+                            Job.TraceIndex = TraceIndex++;
+                        }
+                        if(Execute && (SimFlags & (SimFlag_JSONRecords|SimFlag_CSVRecords)) && !(SimFlags & SimFlag_BlockExec))
+                        {
+                            Job.RecordsIndex = RecordsIndex++;
+                        }
+                        if(Execute && (SimFlags & SimFlag_FoldedStacks) && !(SimFlags & SimFlag_BlockExec))
+                        {
+                            Job.StacksIndex = StacksIndex++;
+                        }
+                        if(Execute && (SimFlags & SimFlag_Snapshot) && !(SimFlags & SimFlag_BlockExec))
+                        {
+                            Job.SnapshotIndex = SnapshotIndex++;
+                            Job.SnapshotAt = SnapshotAt;
+                        }
+                        
+                        if(Batch)
+                        {
+                            if(JobCount == MaxJobCount)
+                            {
+                                MaxJobCount = MaxJobCount ? 2*MaxJobCount : 64;
+                                Jobs = (sim_job *)realloc(Jobs, MaxJobCount*sizeof(sim_job));
+                                if(!Jobs)
+                                {
+                                    fprintf(stderr, "ERROR: Unable to allocate batch.\n");
+                                    return 1;
+                                }
+                            }
+                            
+                            Jobs[JobCount++] = Job;
+                        }
+                        else
+                        {
+                            ProcessFile(&Context, &Job, stdout);
+                        }
+                    } while(ListFile && *NextName);
+                }
+            }
+            
+            if(JobCount)
+            {
+                RunBatch(&Context, JobCount, Jobs);
             }
         }
         else
         {
             fprintf(stderr, "USAGE: %s [8086 machine code file] ...\n", Args[0]);
+            fprintf(stderr, "       %s -exec [-quiet|-bench] [-blocks] [-nocache] [-cachestats] [8086 machine code file] ...\n", Args[0]);
+            fprintf(stderr, "       (see README.md for the other switches)\n");
         }
     }
     else
@@ -0,0 +1,502 @@
+/* ========================================================================
+
+   sim86_bench.cpp - Decode and flag benchmarks, checked against the reference implementations
+
+   ======================================================================== */
+
+#include "sim86.h"
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "sim86_instruction.h"
+#include "sim86_instruction_table.h"
+#include "sim86_memory.h"
+#include "sim86_decode.h"
+#include "sim86_execute.h"
+#include "sim86_platform.h"
+
+#include "sim86_instruction.cpp"
+#include "sim86_instruction_table.cpp"
+#include "sim86_memory.cpp"
+#include "sim86_decode.cpp"
+#include "sim86_decode_compiled.cpp"
+#include "sim86_execute.cpp"
+#include "sim86_platform.cpp"
+
+static instruction DecodeInstructionInterpreted(instruction_table Table, segmented_access At)
+{
+    // NOTE(agent): This uses the dispatch table, but decodes the candidates by interpreting the
+    // instruction table rather than with the compiled decoders (see sim86_decode_compiled.cpp).
+    // It is the reference the compiled decoders are checked against.
+    instruction Result = DecodeInstructionWith(Table, GetDecodeDispatch(Table), 0, At);
+    return Result;
+}
+
+static instruction DecodeInstructionByTableScan(instruction_table Table, segmented_access At)
+{
+    // NOTE(agent): This is the original decoder, which checks every entry in the table until it finds
+    // a match. It is kept as a reference to check (and benchmark) the dispatch table against.
+    instruction Result = DecodeInstructionWith(Table, 0, 0, At);
+    return Result;
+}
+
+typedef instruction decode_function(instruction_table Table, segmented_access At);
+
+struct bench_result
+{
+    u64 InstructionCount;
+    u64 ElapsedTime;
+};
+
+static u32 LoadBenchFile(char *FileName, segmented_access SegMem)
+{
+    u32 Result = 0;
+    
+    FILE *File = fopen(FileName, "rb");
+    if(File)
+    {
+        Result = (u32)fread(SegMem.Memory, 1, GetHighestAddress(SegMem) + 1, File);
+        fclose(File);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to open %s.\n", FileName);
+    }
+    
+    return Result;
+}
+
+static bench_result BenchDecode(decode_function *Decode, instruction_table Table, segmented_access Memory, u32 ByteCount,
+                                u64 MinElapsedTime)
+{
+    bench_result Result = {};
+    
+    u64 StartTime = ReadOSTimer();
+    while(Result.ElapsedTime < MinElapsedTime)
+    {
+        segmented_access At = Memory;
+        u32 Count = ByteCount;
+        while(Count)
+        {
+            instruction Instruction = Decode(Table, At);
+            if(!Instruction.Op || (Instruction.Size > Count))
+            {
+                break;
+            }
+            
+            At = MoveBaseBy(At, Instruction.Size);
+            Count -= Instruction.Size;
+            ++Result.InstructionCount;
+        }
+        
+        Result.ElapsedTime = ReadOSTimer() - StartTime;
+    }
+    
+    return Result;
+}
+
+static b32 DecodersAgreeAt(instruction_table Table, segmented_access At)
+{
+    instruction Reference = DecodeInstructionByTableScan(Table, At);
+    instruction Interpreted = DecodeInstructionInterpreted(Table, At);
+    instruction Compiled = DecodeInstruction(Table, At);
+    
+    b32 Result = ((memcmp(&Reference, &Interpreted, sizeof(Reference)) == 0) &&
+                  (memcmp(&Reference, &Compiled, sizeof(Reference)) == 0));
+    return Result;
+}
+
+static b32 DecodersMatch(instruction_table Table, segmented_access Memory, u32 ByteCount)
+{
+    b32 Result = true;
+    
+    segmented_access At = Memory;
+    u32 Count = ByteCount;
+    while(Result && Count)
+    {
+        instruction Reference = DecodeInstructionByTableScan(Table, At);
+        if(!DecodersAgreeAt(Table, At))
+        {
+            fprintf(stderr, "ERROR: Decoders disagree at address %u.\n", GetAbsoluteAddressOf(At));
+            Result = false;
+        }
+        
+        if(!Reference.Op || (Reference.Size > Count))
+        {
+            break;
+        }
+        
+        At = MoveBaseBy(At, Reference.Size);
+        Count -= Reference.Size;
+    }
+    
+    return Result;
+}
+
+static b32 VerifyAllBytePatterns(instruction_table Table)
+{
+    // NOTE(agent): Every possible value of the first three bytes is decoded by both the interpreted and
+    // the compiled decoder, followed by each of a few fills for the remaining bytes. Three bytes covers
+    // every opcode byte and ModRM byte, including after a prefix, and the fills cover the displacement
+    // and data bytes. (The table scan is left out, since at its speed this would take many minutes.)
+    u8 Fills[] = {0x00, 0xff, 0x55, 0xaa};
+    
+    b32 Result = true;
+    u8 Bytes[16] = {};
+    segmented_access At = FixedMemoryPow2(4, Bytes);
+    
+    u64 CheckCount = 0;
+    for(u32 FillIndex = 0; Result && (FillIndex < ArrayCount(Fills)); ++FillIndex)
+    {
+        for(u32 ByteIndex = 3; ByteIndex < ArrayCount(Bytes); ++ByteIndex)
+        {
+            Bytes[ByteIndex] = (u8)(Fills[FillIndex] + ByteIndex);
+        }
+        
+        for(u32 Pattern = 0; Pattern < (1 << 24); ++Pattern)
+        {
+            Bytes[0] = (u8)(Pattern >> 16);
+            Bytes[1] = (u8)(Pattern >> 8);
+            Bytes[2] = (u8)(Pattern >> 0);
+            
+            instruction Interpreted = DecodeInstructionInterpreted(Table, At);
+            instruction Compiled = DecodeInstruction(Table, At);
+            
+            ++CheckCount;
+            if(memcmp(&Interpreted, &Compiled, sizeof(Interpreted)) != 0)
+            {
+                fprintf(stderr, "ERROR: Decoders disagree on bytes");
+                for(u32 ByteIndex = 0; ByteIndex < ArrayCount(Bytes); ++ByteIndex)
+                {
+                    fprintf(stderr, " %02x", Bytes[ByteIndex]);
+                }
+                fprintf(stderr, "\n");
+                
+                Result = false;
+                break;
+            }
+        }
+    }
+    
+    printf("Verified %llu byte patterns: %s\n", CheckCount, Result ? "decoders agree" : "MISMATCH");
+    return Result;
+}
+
+static double InstructionsPerSecond(bench_result Bench, u64 TimerFreq)
+{
+    double Result = 0;
+    if(Bench.ElapsedTime)
+    {
+        Result = (double)Bench.InstructionCount * (double)TimerFreq / (double)Bench.ElapsedTime;
+    }
+    
+    return Result;
+}
+
+//
+// NOTE(agent): ALU benchmark. Each function does what add and and do to their result and the flags,
+// for every pair of operands, so the only difference between them is how the flags are computed.
+//
+
+#define ALU_BENCH_OPERAND_COUNT (1 << 16)
+
+struct alu_operands
+{
+    u32 V0;
+    u32 V1;
+};
+
+typedef u32 alu_function(register_state_8086 *Registers, alu_operands *Operands, u32 Count, u32 WWidth);
+
+static void UpdateCommonFlagsComputed(register_state_8086 *Registers, u32 MaskedResult, u32 WWidth)
+{
+    // NOTE(agent): This is how SF, ZF and PF were set before the flags table (see CommonFlagsTable).
+    Registers->flags &= ~(Flag_SF | Flag_ZF | Flag_PF);
+    Registers->flags |= (MaskedResult & SignBitFor(WWidth)) ? Flag_SF : 0;
+    Registers->flags |= (MaskedResult == 0) ? Flag_ZF : 0;
+    Registers->flags |= ParityFlagOf(MaskedResult);
+}
+
+static u32 AddAndWithComputedFlags(register_state_8086 *Registers, alu_operands *Operands, u32 Count, u32 WWidth)
+{
+    // NOTE(agent): This is how UpdateArithFlags and UpdateLogFlags worked before the flags table.
+    u32 Result = 0;
+    for(u32 Index = 0; Index < Count; ++Index)
+    {
+        u32 V0 = Operands[Index].V0;
+        u32 V1 = Operands[Index].V1;
+        
+        u32 SignBit = SignBitFor(WWidth);
+        u32 Mask = WidthMaskFor(WWidth);
+        u32 R = (V0 & Mask) + (V1 & Mask);
+        b32 CF = (R & (SignBit << 1));
+        b32 OF = (~(V0 ^ V1) & (V0 ^ R)) & SignBit;
+        b32 AF = ((V0 & 0xf) + (V1 & 0xf)) & 0x10;
+        Registers->flags &= ~(Flag_OF | Flag_CF | Flag_AF);
+        Registers->flags |= CF ? Flag_CF : 0;
+        Registers->flags |= OF ? Flag_OF : 0;
+        Registers->flags |= AF ? Flag_AF : 0;
+        UpdateCommonFlagsComputed(Registers, R & Mask, WWidth);
+        Result += Registers->flags;
+        
+        Registers->flags &= ~(Flag_OF | Flag_CF | Flag_AF);
+        UpdateCommonFlagsComputed(Registers, (u16)(V0 & V1), WWidth);
+        Result += Registers->flags;
+    }
+    
+    return Result;
+}
+
+static u32 AddAndWithTableFlags(register_state_8086 *Registers, alu_operands *Operands, u32 Count, u32 WWidth)
+{
+    u32 Result = 0;
+    for(u32 Index = 0; Index < Count; ++Index)
+    {
+        u32 V0 = Operands[Index].V0;
+        u32 V1 = Operands[Index].V1;
+        
+        u32 SignBit = SignBitFor(WWidth);
+        u32 Mask = WidthMaskFor(WWidth);
+        u32 R = (V0 & Mask) + (V1 & Mask);
+        b32 OF = (~(V0 ^ V1) & (V0 ^ R)) & SignBit;
+        b32 AF = ((V0 & 0xf) + (V1 & 0xf)) & 0x10;
+        UpdateArithFlags(Registers, R, R & Mask, WWidth, OF, AF);
+        Result += Registers->flags;
+        
+        UpdateLogFlags(Registers, (u16)(V0 & V1), WWidth);
+        Result += Registers->flags;
+    }
+    
+    return Result;
+}
+
+template<u32 WWidth>
+static u32 AddAndWithTableFlagsFor(register_state_8086 *Registers, alu_operands *Operands, u32 Count)
+{
+    u32 Result = 0;
+    for(u32 Index = 0; Index < Count; ++Index)
+    {
+        u32 V0 = Operands[Index].V0;
+        u32 V1 = Operands[Index].V1;
+        
+        u32 SignBit = SignBitFor(WWidth);
+        u32 Mask = WidthMaskFor(WWidth);
+        u32 R = (V0 & Mask) + (V1 & Mask);
+        b32 OF = (~(V0 ^ V1) & (V0 ^ R)) & SignBit;
+        b32 AF = ((V0 & 0xf) + (V1 & 0xf)) & 0x10;
+        UpdateArithFlagsFor<WWidth>(Registers, R, R & Mask, OF, AF);
+        Result += Registers->flags;
+        
+        UpdateLogFlagsFor<WWidth>(Registers, (u16)(V0 & V1));
+        Result += Registers->flags;
+    }
+    
+    return Result;
+}
+
+static u32 AddAndWithSpecializedFlags(register_state_8086 *Registers, alu_operands *Operands, u32 Count, u32 WWidth)
+{
+    u32 Result = (WWidth == 1) ?
+        AddAndWithTableFlagsFor<1>(Registers, Operands, Count) :
+        AddAndWithTableFlagsFor<2>(Registers, Operands, Count);
+    return Result;
+}
+
+static bench_result BenchALU(alu_function *Function, alu_operands *Operands, u32 Count, u32 WWidth,
+                             u64 MinElapsedTime, u32 *Checksum)
+{
+    bench_result Result = {};
+    register_state_8086 Registers = {};
+    
+    u64 StartTime = ReadOSTimer();
+    while(Result.ElapsedTime < MinElapsedTime)
+    {
+        *Checksum += Function(&Registers, Operands, Count, WWidth);
+        Result.InstructionCount += 2*Count;
+        Result.ElapsedTime = ReadOSTimer() - StartTime;
+    }
+    
+    return Result;
+}
+
+static b32 FlagsTableMatches(void)
+{
+    // NOTE(agent): Every 16-bit value (and a few beyond, which an unmasked test result can produce)
+    // has to give the same flags from the table as from computing them, starting from both all flags
+    // clear and all flags set.
+    b32 Result = true;
+    for(u32 WWidth = 1; Result && (WWidth <= 2); ++WWidth)
+    {
+        for(u32 Value = 0; Result && (Value < 0x10100); ++Value)
+        {
+            for(u32 Initial = 0; Initial < 2; ++Initial)
+            {
+                register_state_8086 Computed = {};
+                Computed.flags = Initial ? 0xffff : 0;
+                register_state_8086 Table = Computed;
+                
+                UpdateCommonFlagsComputed(&Computed, Value, WWidth);
+                if(WWidth == 1)
+                {
+                    UpdateCommonFlagsFor<1>(&Table, Value);
+                }
+                else
+                {
+                    UpdateCommonFlagsFor<2>(&Table, Value);
+                }
+                if(Computed.flags != Table.flags)
+                {
+                    fprintf(stderr, "ERROR: Flags table disagrees for %u-byte value 0x%x.\n", WWidth, Value);
+                    Result = false;
+                    break;
+                }
+            }
+        }
+    }
+    
+    return Result;
+}
+
+static b32 BenchALUFlags(u64 MinElapsedTime)
+{
+    b32 Result = FlagsTableMatches();
+    alu_operands *Operands = (alu_operands *)malloc(ALU_BENCH_OPERAND_COUNT*sizeof(alu_operands));
+    if(Result && Operands)
+    {
+        u32 Random = 0x12345678;
+        for(u32 Index = 0; Index < ALU_BENCH_OPERAND_COUNT; ++Index)
+        {
+            Random ^= Random << 13;
+            Random ^= Random >> 17;
+            Random ^= Random << 5;
+            Operands[Index].V0 = Random & 0xffff;
+            Operands[Index].V1 = Random >> 16;
+        }
+        
+        u64 TimerFreq = GetOSTimerFreq();
+        for(u32 WWidth = 1; WWidth <= 2; ++WWidth)
+        {
+            u32 Checksums[3] = {};
+            bench_result Computed = BenchALU(AddAndWithComputedFlags, Operands, ALU_BENCH_OPERAND_COUNT, WWidth, MinElapsedTime, &Checksums[0]);
+            bench_result Table = BenchALU(AddAndWithTableFlags, Operands, ALU_BENCH_OPERAND_COUNT, WWidth, MinElapsedTime, &Checksums[1]);
+            bench_result Specialized = BenchALU(AddAndWithSpecializedFlags, Operands, ALU_BENCH_OPERAND_COUNT, WWidth, MinElapsedTime, &Checksums[2]);
+            
+            // NOTE(agent): Each run repeats the same operands a different number of times, so the checksums
+            // are only compared for one pass.
+            register_state_8086 Registers = {};
+            u32 ComputedPass = AddAndWithComputedFlags(&Registers, Operands, ALU_BENCH_OPERAND_COUNT, WWidth);
+            Registers = {};
+            u32 TablePass = AddAndWithTableFlags(&Registers, Operands, ALU_BENCH_OPERAND_COUNT, WWidth);
+            Registers = {};
+            u32 SpecializedPass = AddAndWithSpecializedFlags(&Registers, Operands, ALU_BENCH_OPERAND_COUNT, WWidth);
+            if((ComputedPass != TablePass) || (ComputedPass != SpecializedPass))
+            {
+                fprintf(stderr, "ERROR: ALU flags disagree for %u-byte operands.\n", WWidth);
+                Result = false;
+            }
+            
+            double ComputedRate = InstructionsPerSecond(Computed, TimerFreq);
+            double TableRate = InstructionsPerSecond(Table, TimerFreq);
+            double SpecializedRate = InstructionsPerSecond(Specialized, TimerFreq);
+            
+            printf("--- %s add/and flags ---\n", (WWidth == 1) ? "byte" : "word");
+            printf("     computed: %10.0f instructions/second\n", ComputedRate);
+            printf("        table: %10.0f instructions/second", TableRate);
+            if(ComputedRate > 0)
+            {
+                printf(" (%.2fx)", TableRate / ComputedRate);
+            }
+            printf("\n");
+            printf("  specialized: %10.0f instructions/second", SpecializedRate);
+            if(ComputedRate > 0)
+            {
+                printf(" (%.2fx)", SpecializedRate / ComputedRate);
+            }
+            printf("\n");
+        }
+    }
+    
+    free(Operands);
+    return Result;
+}
+
+int main(int ArgCount, char **Args)
+{
+    u32 MemoryPow2 = 20;
+    u8 *Memory = (u8 *)malloc(1 << MemoryPow2);
+    if(Memory)
+    {
+        if((ArgCount == 2) && (strcmp(Args[1], "-verify") == 0))
+        {
+            if(!VerifyAllBytePatterns(Get8086InstructionTable()))
+            {
+                return 1;
+            }
+        }
+        else if((ArgCount == 2) && (strcmp(Args[1], "-alu") == 0))
+        {
+            if(!BenchALUFlags(GetOSTimerFreq() / 2))
+            {
+                return 1;
+            }
+        }
+        else if(ArgCount > 1)
+        {
+            segmented_access MainMemory = FixedMemoryPow2(MemoryPow2, Memory);
+            instruction_table Table = Get8086InstructionTable();
+            
+            u64 TimerFreq = GetOSTimerFreq();
+            u64 MinElapsedTime = TimerFreq / 2;
+            
+            for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+            {
+                char *FileName = Args[ArgIndex];
+                
+                memset(Memory, 0, 1 << MemoryPow2);
+                u32 ByteCount = LoadBenchFile(FileName, MainMemory);
+                if(ByteCount && DecodersMatch(Table, MainMemory, ByteCount))
+                {
+                    bench_result Scan = BenchDecode(DecodeInstructionByTableScan, Table, MainMemory, ByteCount, MinElapsedTime);
+                    bench_result Dispatch = BenchDecode(DecodeInstructionInterpreted, Table, MainMemory, ByteCount, MinElapsedTime);
+                    bench_result Compiled = BenchDecode(DecodeInstruction, Table, MainMemory, ByteCount, MinElapsedTime);
+                    
+                    double ScanRate = InstructionsPerSecond(Scan, TimerFreq);
+                    double DispatchRate = InstructionsPerSecond(Dispatch, TimerFreq);
+                    double CompiledRate = InstructionsPerSecond(Compiled, TimerFreq);
+                    
+                    printf("--- %s decode ---\n", FileName);
+                    printf("  table scan: %10.0f instructions/second\n", ScanRate);
+                    printf("    dispatch: %10.0f instructions/second", DispatchRate);
+                    if(ScanRate > 0)
+                    {
+                        printf(" (%.2fx)", DispatchRate / ScanRate);
+                    }
+                    printf("\n");
+                    printf("    compiled: %10.0f instructions/second", CompiledRate);
+                    if(ScanRate > 0)
+                    {
+                        printf(" (%.2fx)", CompiledRate / ScanRate);
+                    }
+                    printf("\n");
+                }
+            }
+        }
+        else
+        {
+            fprintf(stderr, "USAGE: %s [8086 machine code file] ...\n", Args[0]);
+            fprintf(stderr, "       %s -verify\n", Args[0]);
+            fprintf(stderr, "       %s -alu\n", Args[0]);
+        }
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to allocate memory for benchmark.\n");
+    }
+    
+    return 0;
+}
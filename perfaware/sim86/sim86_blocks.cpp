@@ -0,0 +1,595 @@
+/* ========================================================================
+
+   sim86_blocks.cpp - Basic-block executor (-blocks)
+
+   ======================================================================== */
+
+static void FlushBlocks(block_machine *Machine)
+{
+    memset(Machine->Blocks, 0, sizeof(Machine->Blocks));
+    ClearWatchedMemory(&Machine->Tracker);
+    Machine->OpCount = 0;
+    ++Machine->BlockFlushes;
+}
+
+static void ResetBlockMachine(block_machine *Machine, segmented_access Memory, b32 StopOnRet)
+{
+    FlushBlocks(Machine);
+    ClearMemoryTracker(&Machine->Tracker);
+    
+    Machine->Memory = Memory;
+    Machine->Memory.Tracker = &Machine->Tracker;
+    Machine->Registers = {};
+    Machine->Flags = {};
+    Machine->StopOnRet = StopOnRet;
+    
+    Machine->InstructionCount = 0;
+    Machine->BlocksBuilt = 0;
+    Machine->BlockFlushes = 0;
+}
+
+//
+// NOTE(agent): Operand resolution. This has to produce exactly what AccessOperand produces, but
+// all the decisions about which registers and segments are involved were already made when the
+// instruction was lowered.
+//
+
+static operand_access ResolveBlockOperand(block_machine *Machine, block_operand *Operand, b32 ReadValue = true)
+{
+    operand_access Result = {};
+    register_state_8086 *Registers = &Machine->Registers;
+    
+    switch(Operand->Type)
+    {
+        case Operand_None:
+        {
+        } break;
+        
+        case Operand_Register:
+        {
+            u8 *Reg = (u8 *)Registers + Operand->RegisterByte;
+            Result.Op = FixedMemoryPow2(Operand->RegisterCount - 1, Reg);
+            Result.Val = (Operand->RegisterCount == 2) ? *(u16 *)Reg : *Reg;
+        } break;
+        
+        case Operand_Memory:
+        {
+            Result.Op = Machine->Memory;
+            Result.Op.Mask = 0xffff;
+            SetSegmentBase(&Result.Op, Registers->u16[Operand->SegmentRegister]);
+            Result.Op.SegmentOffset = (Operand->Displacement +
+                                       Registers->u16[Operand->Term0] +
+                                       Registers->u16[Operand->Term1]);
+            if(ReadValue)
+            {
+                Result.Val = ReadU16(Result.Op, 0);
+            }
+        } break;
+        
+        case Operand_Immediate:
+        {
+            Result.Val = Operand->Immediate;
+        } break;
+    }
+    
+    return Result;
+}
+
+//
+// NOTE(agent): Lazy flags. The formulas here have to stay exactly the same as the ones
+// ExecInstruction uses for the same operations.
+//
+
+static void SetLazyFlags(block_machine *Machine, lazy_flags_op Op, u32 V0, u32 V1, u32 Result, u32 WWidth)
+{
+    lazy_flags *Flags = &Machine->Flags;
+    Flags->Op = Op;
+    Flags->V0 = V0;
+    Flags->V1 = V1;
+    Flags->Result = Result;
+    Flags->WWidth = WWidth;
+}
+
+static void MaterializeFlags(block_machine *Machine)
+{
+    lazy_flags *Flags = &Machine->Flags;
+    register_state_8086 *Registers = &Machine->Registers;
+    
+    u32 V0 = Flags->V0;
+    u32 V1 = Flags->V1;
+    u32 R = Flags->Result;
+    u32 WWidth = Flags->WWidth;
+    u32 SignBit = SignBitFor(WWidth);
+    u32 WidthMask = WidthMaskFor(WWidth);
+    
+    switch(Flags->Op)
+    {
+        case LazyFlags_Add:
+        {
+            b32 OF = (~(V0 ^ V1) & (V0 ^ R)) & SignBit;
+            b32 AF = ((V0 & 0xf) + (V1 & 0xf)) & 0x10;
+            UpdateArithFlags(Registers, R, R & WidthMask, WWidth, OF, AF);
+        } break;
+        
+        case LazyFlags_Sub:
+        {
+            b32 OF = ((V0 ^ V1) & (V0 ^ R)) & SignBit;
+            b32 AF = ((V0 & 0xf) - (V1 & 0xf)) & 0x10;
+            UpdateArithFlags(Registers, R, R & WidthMask, WWidth, OF, AF);
+        } break;
+        
+        case LazyFlags_IncDec:
+        {
+            UpdateArithFlags(Registers, R, R & WidthMask, WWidth);
+        } break;
+        
+        case LazyFlags_Logic:
+        {
+            // NOTE(agent): Not masked here, because test passes its result through unmasked.
+            UpdateLogFlags(Registers, (u16)R, WWidth);
+        } break;
+        
+        case LazyFlags_None: {} break;
+    }
+    
+    Flags->Op = LazyFlags_None;
+}
+
+//
+// NOTE(agent): Handlers. Each one must do exactly what the corresponding case in ExecInstruction does.
+// They return false if the simulation has to stop.
+//
+
+static b32 BlockOp_Exec(block_machine *Machine, block_op *Op)
+{
+    // NOTE(agent): ExecInstruction reads and writes the flags register directly.
+    MaterializeFlags(Machine);
+    
+    exec_result Exec = ExecInstruction(Machine->Memory, &Machine->Registers, Op->Instruction);
+    
+    b32 Result = !Exec.Unimplemented;
+    if(!Result)
+    {
+        fprintf(Machine->Out, "ERROR: Unimplemented instruction (%s).\n", GetMnemonic(Op->Instruction.Op));
+    }
+    
+    return Result;
+}
+
+static b32 BlockOp_StopOnRet(block_machine *Machine, block_op *Op)
+{
+    // NOTE(agent): The ret has not executed, so ip goes back to pointing at it.
+    Machine->Registers.ip = (u16)(Op->NextIP - Op->Instruction.Size);
+    fprintf(Machine->Out, "STOPONRET: Return encountered at address %u.\n", Op->Instruction.Address);
+    return false;
+}
+
+static b32 BlockOp_mov(block_machine *Machine, block_op *Op)
+{
+    operand_access Op0 = ResolveBlockOperand(Machine, &Op->Operands[0], false);
+    operand_access Op1 = ResolveBlockOperand(Machine, &Op->Operands[1]);
+    WriteN(Op0.Op, 0, Op1.Val, Op->WWidth);
+    return true;
+}
+
+static b32 BlockOp_add(block_machine *Machine, block_op *Op)
+{
+    operand_access Op0 = ResolveBlockOperand(Machine, &Op->Operands[0]);
+    operand_access Op1 = ResolveBlockOperand(Machine, &Op->Operands[1]);
+    
+    u32 WWidth = Op->WWidth;
+    u32 V0 = Op0.Val;
+    u32 V1 = Op1.Val;
+    
+    u32 Mask = WidthMaskFor(WWidth);
+    u32 R = (V0 & Mask) + (V1 & Mask);
+    SetLazyFlags(Machine, LazyFlags_Add, V0, V1, R, WWidth);
+    WriteN(Op0.Op, 0, R & Mask, WWidth);
+    
+    return true;
+}
+
+static b32 BlockOp_sub(block_machine *Machine, block_op *Op)
+{
+    operand_access Op0 = ResolveBlockOperand(Machine, &Op->Operands[0]);
+    operand_access Op1 = ResolveBlockOperand(Machine, &Op->Operands[1]);
+    
+    u32 WWidth = Op->WWidth;
+    u32 V0 = Op0.Val;
+    u32 V1 = Op1.Val;
+    
+    u32 WidthMask = WidthMaskFor(WWidth);
+    u32 R = (V0 & WidthMask) - (V1 & WidthMask);
+    SetLazyFlags(Machine, LazyFlags_Sub, V0, V1, R, WWidth);
+    WriteN(Op0.Op, 0, R & WidthMask, WWidth);
+    
+    return true;
+}
+
+static b32 BlockOp_cmp(block_machine *Machine, block_op *Op)
+{
+    operand_access Op0 = ResolveBlockOperand(Machine, &Op->Operands[0]);
+    operand_access Op1 = ResolveBlockOperand(Machine, &Op->Operands[1]);
+    
+    u32 WWidth = Op->WWidth;
+    u32 V0 = Op0.Val;
+    u32 V1 = Op1.Val;
+    
+    u32 WidthMask = WidthMaskFor(WWidth);
+    u32 R = (V0 & WidthMask) - (V1 & WidthMask);
+    SetLazyFlags(Machine, LazyFlags_Sub, V0, V1, R, WWidth);
+    
+    return true;
+}
+
+static b32 BlockOp_inc(block_machine *Machine, block_op *Op)
+{
+    operand_access Op0 = ResolveBlockOperand(Machine, &Op->Operands[0]);
+    u32 R = Op0.Val + 1;
+    SetLazyFlags(Machine, LazyFlags_IncDec, 0, 0, R, Op->WWidth);
+    WriteN(Op0.Op, 0, R & WidthMaskFor(Op->WWidth), Op->WWidth);
+    return true;
+}
+
+static b32 BlockOp_dec(block_machine *Machine, block_op *Op)
+{
+    operand_access Op0 = ResolveBlockOperand(Machine, &Op->Operands[0]);
+    u32 R = Op0.Val - 1;
+    SetLazyFlags(Machine, LazyFlags_IncDec, 0, 0, R, Op->WWidth);
+    WriteN(Op0.Op, 0, R & WidthMaskFor(Op->WWidth), Op->WWidth);
+    return true;
+}
+
+static void WriteLazyLogOpResult(block_machine *Machine, segmented_access Dest, u16 UnmaskedResult, u32 WWidth)
+{
+    u16 MaskedResult = UnmaskedResult & WidthMaskFor(WWidth);
+    SetLazyFlags(Machine, LazyFlags_Logic, 0, 0, MaskedResult, WWidth);
+    WriteN(Dest, 0, MaskedResult, WWidth);
+}
+
+static b32 BlockOp_and(block_machine *Machine, block_op *Op)
+{
+    operand_access Op0 = ResolveBlockOperand(Machine, &Op->Operands[0]);
+    operand_access Op1 = ResolveBlockOperand(Machine, &Op->Operands[1]);
+    WriteLazyLogOpResult(Machine, Op0.Op, Op0.Val & Op1.Val, Op->WWidth);
+    return true;
+}
+
+static b32 BlockOp_or(block_machine *Machine, block_op *Op)
+{
+    operand_access Op0 = ResolveBlockOperand(Machine, &Op->Operands[0]);
+    operand_access Op1 = ResolveBlockOperand(Machine, &Op->Operands[1]);
+    WriteLazyLogOpResult(Machine, Op0.Op, Op0.Val | Op1.Val, Op->WWidth);
+    return true;
+}
+
+static b32 BlockOp_xor(block_machine *Machine, block_op *Op)
+{
+    operand_access Op0 = ResolveBlockOperand(Machine, &Op->Operands[0]);
+    operand_access Op1 = ResolveBlockOperand(Machine, &Op->Operands[1]);
+    WriteLazyLogOpResult(Machine, Op0.Op, Op0.Val ^ Op1.Val, Op->WWidth);
+    return true;
+}
+
+static b32 BlockOp_test(block_machine *Machine, block_op *Op)
+{
+    operand_access Op0 = ResolveBlockOperand(Machine, &Op->Operands[0]);
+    operand_access Op1 = ResolveBlockOperand(Machine, &Op->Operands[1]);
+    SetLazyFlags(Machine, LazyFlags_Logic, 0, 0, Op0.Val & Op1.Val, Op->WWidth);
+    return true;
+}
+
+static b32 BlockOp_jcc(block_machine *Machine, block_op *Op)
+{
+    MaterializeFlags(Machine);
+    
+    exec_result Ignored = {};
+    register_state_8086 *Registers = &Machine->Registers;
+    ConditionalJump(&Ignored, Registers, Op->Operands[0].Immediate, JumpConditionHolds(Op->Instruction.Op, Registers->flags));
+    return true;
+}
+
+static b32 BlockOp_loop(block_machine *Machine, block_op *Op)
+{
+    exec_result Ignored = {};
+    register_state_8086 *Registers = &Machine->Registers;
+    ConditionalJump(&Ignored, Registers, Op->Operands[0].Immediate, --Registers->cx != 0);
+    return true;
+}
+
+//
+// NOTE(agent): Lowering
+//
+
+static b32 LowerOperand(instruction Instruction, instruction_operand Source, block_operand *Dest)
+{
+    b32 Result = true;
+    
+    *Dest = {};
+    Dest->Type = Source.Type;
+    
+    switch(Source.Type)
+    {
+        case Operand_None:
+        {
+        } break;
+        
+        case Operand_Register:
+        {
+            register_access Reg = Source.Register;
+            Dest->RegisterByte = 2*(Reg.Index % Register_count) + Reg.Offset;
+            Dest->RegisterCount = Reg.Count;
+            Result = ((Reg.Offset <= 1) && (Reg.Count >= 1) && ((Reg.Offset + Reg.Count) <= 2));
+        } break;
+        
+        case Operand_Memory:
+        {
+            // NOTE(agent): Explicit segments (far jumps and calls) and anything other than the plain
+            // [base + index + disp] addressing the 8086 has are left to ExecInstruction.
+            effective_address_expression Address = Source.Address;
+            Result = !(Address.Flags & Address_ExplicitSegment);
+            for(u32 TermIndex = 0; TermIndex < ArrayCount(Address.Terms); ++TermIndex)
+            {
+                effective_address_term Term = Address.Terms[TermIndex];
+                Result = Result && (Term.Scale == 1) && (Term.Register.Offset == 0) && (Term.Register.Count == 2);
+            }
+            
+            Dest->Term0 = Address.Terms[0].Register.Index % Register_count;
+            Dest->Term1 = Address.Terms[1].Register.Index % Register_count;
+            Dest->Displacement = (u16)Address.Displacement;
+            
+            if(Instruction.SegmentOverride)
+            {
+                Dest->SegmentRegister = Instruction.SegmentOverride % Register_count;
+            }
+            else
+            {
+                Dest->SegmentRegister = (Address.Terms[0].Register.Index == Register_bp) ? Register_ss : Register_ds;
+            }
+        } break;
+        
+        case Operand_Immediate:
+        {
+            Dest->Immediate = Source.Immediate.Value;
+        } break;
+    }
+    
+    return Result;
+}
+
+static b32 IsBlockTerminator(instruction Instruction)
+{
+    b32 Result = false;
+    
+    switch(Instruction.Op)
+    {
+        case Op_je:
+        case Op_jl:
+        case Op_jle:
+        case Op_jb:
+        case Op_jbe:
+        case Op_jp:
+        case Op_jo:
+        case Op_js:
+        case Op_jne:
+        case Op_jnl:
+        case Op_jg:
+        case Op_jnb:
+        case Op_ja:
+        case Op_jnp:
+        case Op_jno:
+        case Op_jns:
+        case Op_loop:
+        case Op_loopz:
+        case Op_loopnz:
+        case Op_jcxz:
+        case Op_call:
+        case Op_jmp:
+        case Op_ret:
+        case Op_retf:
+        case Op_int:
+        case Op_int3:
+        case Op_into:
+        case Op_iret:
+        case Op_div: // NOTE(agent): Divide by zero raises an interrupt
+        {
+            Result = true;
+        } break;
+        
+        default:
+        {
+            // NOTE(agent): Anything that writes cs changes where the next instruction comes from.
+            instruction_operand Dest = Instruction.Operands[0];
+            Result = ((Dest.Type == Operand_Register) && (Dest.Register.Index == Register_cs));
+        } break;
+    }
+    
+    return Result;
+}
+
+static void LowerInstruction(block_machine *Machine, block_op *Op, instruction Instruction, u16 NextIP)
+{
+    *Op = {};
+    Op->Handler = BlockOp_Exec;
+    Op->NextIP = NextIP;
+    Op->WWidth = (Instruction.Flags & Inst_Wide) ? 2 : 1;
+    Op->Instruction = Instruction;
+    
+    b32 Lowered = true;
+    for(u32 OperandIndex = 0; OperandIndex < ArrayCount(Op->Operands); ++OperandIndex)
+    {
+        Lowered = LowerOperand(Instruction, Instruction.Operands[OperandIndex], &Op->Operands[OperandIndex]) && Lowered;
+    }
+    
+    if(Machine->StopOnRet && ((Instruction.Op == Op_ret) || (Instruction.Op == Op_retf)))
+    {
+        Op->Handler = BlockOp_StopOnRet;
+    }
+    else if(Lowered)
+    {
+        switch(Instruction.Op)
+        {
+            case Op_mov: {Op->Handler = BlockOp_mov;} break;
+            case Op_add: {Op->Handler = BlockOp_add;} break;
+            case Op_sub: {Op->Handler = BlockOp_sub;} break;
+            case Op_cmp: {Op->Handler = BlockOp_cmp;} break;
+            case Op_inc: {Op->Handler = BlockOp_inc;} break;
+            case Op_dec: {Op->Handler = BlockOp_dec;} break;
+            case Op_and: {Op->Handler = BlockOp_and;} break;
+            case Op_or: {Op->Handler = BlockOp_or;} break;
+            case Op_xor: {Op->Handler = BlockOp_xor;} break;
+            case Op_test: {Op->Handler = BlockOp_test;} break;
+            case Op_loop: {Op->Handler = BlockOp_loop;} break;
+            
+            case Op_je:
+            case Op_jl:
+            case Op_jle:
+            case Op_jb:
+            case Op_jbe:
+            case Op_jp:
+            case Op_jo:
+            case Op_js:
+            case Op_jne:
+            case Op_jnl:
+            case Op_jg:
+            case Op_jnb:
+            case Op_ja:
+            case Op_jnp:
+            case Op_jno:
+            case Op_jns:
+            {
+                Op->Handler = BlockOp_jcc;
+            } break;
+            
+            default: {} break;
+        }
+    }
+}
+
+static block_entry *GetBlockAt(block_machine *Machine, instruction_table Table, segmented_access At, u32 OnePastLastByte)
+{
+    u32 AbsAddr = GetAbsoluteAddressOf(At);
+    block_entry *Result = Machine->Blocks + (AbsAddr & ((1 << BLOCK_TABLE_SIZE_POW2) - 1));
+    
+    if(Result->Tag != (AbsAddr + 1))
+    {
+        if((Machine->OpCount + MAX_BLOCK_OP_COUNT) > ArrayCount(Machine->Ops))
+        {
+            FlushBlocks(Machine);
+        }
+        
+        Result->Tag = 0;
+        Result->FirstOp = Machine->OpCount;
+        Result->OpCount = 0;
+        
+        segmented_access Next = At;
+        while(Result->OpCount < MAX_BLOCK_OP_COUNT)
+        {
+            u32 InstAddr = GetAbsoluteAddressOf(Next);
+            if(InstAddr >= OnePastLastByte)
+            {
+                break;
+            }
+            
+            instruction Instruction = DecodeInstruction(Table, Next);
+            if(!Instruction.Op)
+            {
+                break;
+            }
+            
+            Next.SegmentOffset += Instruction.Size;
+            LowerInstruction(Machine, Machine->Ops + Machine->OpCount++, Instruction, Next.SegmentOffset);
+            WatchMemory(&Machine->Tracker, InstAddr, Instruction.Size);
+            ++Result->OpCount;
+            
+            if(IsBlockTerminator(Instruction))
+            {
+                break;
+            }
+        }
+        
+        if(Result->OpCount)
+        {
+            Result->Tag = AbsAddr + 1;
+            ++Machine->BlocksBuilt;
+        }
+        else
+        {
+            Result = 0;
+        }
+    }
+    
+    return Result;
+}
+
+static b32 RunBlock(block_machine *Machine, block_entry *Block)
+{
+    b32 Result = true;
+    
+    block_op *Op = Machine->Ops + Block->FirstOp;
+    block_op *OnePastLastOp = Op + Block->OpCount;
+    while(Op < OnePastLastOp)
+    {
+        // NOTE(agent): ip is kept exact for every instruction, because the fallback handler and
+        // the branches need it, and because a block can be exited after any instruction.
+        Machine->Registers.ip = Op->NextIP;
+        Result = Op->Handler(Machine, Op);
+        if(!Result)
+        {
+            break;
+        }
+        
+        ++Machine->InstructionCount;
+        
+        if(Machine->Tracker.WatchedPageWritten)
+        {
+            // NOTE(agent): The program wrote into memory that some block was built from. Rather than
+            // figure out which blocks are affected, all of them are discarded - this is rare enough
+            // that it doesn't matter. The current block's ops are still intact until the next build,
+            // but execution has to continue from freshly decoded code.
+            FlushBlocks(Machine);
+            break;
+        }
+        
+        ++Op;
+    }
+    
+    return Result;
+}
+
+static void RunBlocks(block_machine *Machine, instruction_table Table, u32 OnePastLastByte, FILE *Out)
+{
+    Machine->Out = Out;
+    
+    for(;;)
+    {
+        segmented_access At = Machine->Memory;
+        At.Mask = 0xffff;
+        SetSegmentBase(&At, Machine->Registers.cs);
+        At.SegmentOffset = Machine->Registers.ip;
+        
+        if(GetAbsoluteAddressOf(At) < OnePastLastByte)
+        {
+            block_entry *Block = GetBlockAt(Machine, Table, At, OnePastLastByte);
+            if(Block)
+            {
+                if(!RunBlock(Machine, Block))
+                {
+                    break;
+                }
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: Unrecognized binary in instruction stream.\n");
+                break;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+    
+    // NOTE(agent): Whoever called this is going to look at the registers.
+    MaterializeFlags(Machine);
+}
@@ -0,0 +1,103 @@
+/* ========================================================================
+
+   sim86_blocks.h - Basic-block executor (-blocks)
+
+   ======================================================================== */
+
+/* NOTE(agent): The block executor runs the same simulation as ExecInstruction, but instead of
+   decoding and switching on every instruction, it splits the program into basic blocks (runs of
+   instructions that end at a branch, call, ret, interrupt, or anything else that can change cs:ip).
+   Each instruction in a block is "lowered" once into a handler pointer plus pre-resolved operands,
+   so running a block is just calling the handlers in order.
+
+   Instructions that don't have a dedicated handler are lowered to a handler that calls
+   ExecInstruction directly, so the results are always the same as the per-instruction simulator.
+*/
+
+struct block_machine;
+struct block_op;
+
+typedef b32 block_op_handler(block_machine *Machine, block_op *Op);
+
+struct block_operand
+{
+    operand_type Type;
+    
+    // NOTE(agent): For registers
+    u32 RegisterByte; // NOTE(agent): Byte offset of the register in register_state_8086
+    u32 RegisterCount;
+    
+    // NOTE(agent): For memory
+    register_index Term0;
+    register_index Term1;
+    register_index SegmentRegister;
+    u16 Displacement;
+    
+    // NOTE(agent): For immediates
+    u32 Immediate;
+};
+
+// NOTE(agent): Almost every arithmetic instruction overwrites all six status flags, so computing
+// them for each one is mostly wasted - usually the next instruction overwrites them again before
+// anything looks at them. Instead, the handlers just record the last flag-setting operation, and
+// the flags are only computed (see MaterializeFlags) when something needs the flags register.
+enum lazy_flags_op
+{
+    LazyFlags_None, // NOTE(agent): Registers.flags is up to date
+    
+    LazyFlags_Add,
+    LazyFlags_Sub,
+    LazyFlags_IncDec,
+    LazyFlags_Logic,
+};
+
+struct lazy_flags
+{
+    lazy_flags_op Op;
+    u32 V0;
+    u32 V1;
+    u32 Result; // NOTE(agent): Unmasked, since CF comes from the bit past the width
+    u32 WWidth;
+};
+
+struct block_op
+{
+    block_op_handler *Handler;
+    u16 NextIP;
+    u32 WWidth;
+    block_operand Operands[2];
+    
+    instruction Instruction;
+};
+
+struct block_entry
+{
+    u32 Tag; // NOTE(agent): Absolute address + 1, so that 0 means "empty"
+    u32 FirstOp;
+    u32 OpCount;
+};
+
+#define BLOCK_TABLE_SIZE_POW2 12
+#define BLOCK_OP_POOL_SIZE (1 << 15)
+#define MAX_BLOCK_OP_COUNT 64
+
+struct block_machine
+{
+    segmented_access Memory;
+    register_state_8086 Registers;
+    lazy_flags Flags;
+    memory_tracker Tracker;
+    b32 StopOnRet;
+    FILE *Out;
+    
+    u64 InstructionCount;
+    u64 BlocksBuilt;
+    u64 BlockFlushes;
+    
+    u32 OpCount;
+    block_entry Blocks[1 << BLOCK_TABLE_SIZE_POW2];
+    block_op Ops[BLOCK_OP_POOL_SIZE];
+};
+
+static void ResetBlockMachine(block_machine *Machine, segmented_access Memory, b32 StopOnRet);
+static void RunBlocks(block_machine *Machine, instruction_table Table, u32 OnePastLastByte, FILE *Out);
@@ -503,3 +503,126 @@ static instruction_clock_interval ExpectedClocksFrom(timing_state State, instruc
     
     return Result;
 }
+
+static void ResetBusState(bus_state *Bus, b32 Assume8088, u32 StartAddress)
+{
+    *Bus = {};
+    
+    // NOTE(agent): The 8088 has a four-byte queue filled one byte per bus cycle, whereas the 8086 has
+    // a six-byte queue filled a word at a time (or a single byte when fetching from an odd address).
+    Bus->QueueSize = Assume8088 ? 4 : 6;
+    Bus->ByteBus = Assume8088;
+    Bus->FetchAddress = StartAddress;
+}
+
+static void TickBus(bus_state *Bus, b32 ExecutionUnitWantsBus)
+{
+    ++Bus->Clock;
+    
+    if(!Bus->FetchClocksLeft && !ExecutionUnitWantsBus)
+    {
+        // NOTE(agent): The 8086 does not start a prefetch until there is room for a whole word in the queue.
+        u32 FreeBytes = Bus->QueueSize - Bus->QueueBytes;
+        if(FreeBytes >= (Bus->ByteBus ? 1u : 2u))
+        {
+            Bus->FetchClocksLeft = BUS_CYCLE_CLOCKS;
+            Bus->FetchBytes = (Bus->ByteBus || (Bus->FetchAddress & 1)) ? 1 : 2;
+        }
+    }
+    
+    if(Bus->FetchClocksLeft)
+    {
+        if(--Bus->FetchClocksLeft == 0)
+        {
+            Bus->QueueBytes += Bus->FetchBytes;
+            Bus->FetchAddress = (Bus->FetchAddress + Bus->FetchBytes) & 0xfffff;
+        }
+    }
+}
+
+static void RunInternalClocks(bus_state *Bus, u32 Clocks)
+{
+    while(Clocks--)
+    {
+        TickBus(Bus, false);
+    }
+}
+
+static void RunBusTransfer(bus_state *Bus, u32 BusCycles)
+{
+    // NOTE(agent): A prefetch that has already started cannot be interrupted, so the transfer has to
+    // wait for it to finish. Once the execution unit has the bus, no new prefetch can start.
+    while(Bus->FetchClocksLeft)
+    {
+        TickBus(Bus, true);
+    }
+    
+    u32 Clocks = BusCycles*BUS_CYCLE_CLOCKS;
+    while(Clocks--)
+    {
+        TickBus(Bus, true);
+    }
+}
+
+static instruction_clock_interval SimulateBusClocks(bus_state *Bus, timing_state State, instruction Instruction,
+                                                    instruction_timing Timing, u32 NextAddress)
+{
+    u64 StartClock = Bus->Clock;
+    
+    // NOTE(agent): The execution unit takes instruction bytes out of the queue as they arrive, so an
+    // instruction longer than the queue (possible on the 8088) still works.
+    u32 BytesNeeded = Instruction.Size;
+    for(;;)
+    {
+        u32 Take = (Bus->QueueBytes < BytesNeeded) ? Bus->QueueBytes : BytesNeeded;
+        Bus->QueueBytes -= Take;
+        BytesNeeded -= Take;
+        if(!BytesNeeded)
+        {
+            break;
+        }
+        
+        TickBus(Bus, false);
+    }
+    
+    // NOTE(agent): The manual clocks assume the instruction is already in the queue, and include four
+    // clocks for each memory transfer. The rest of the time is treated as internal execution that the
+    // bus is free to prefetch during. Since the manual does not say where the transfers fall within
+    // an instruction, the first one is assumed to happen right after the effective address is
+    // computed, and any others (like the write of a read-modify-write) at the end. Where the manual
+    // gives a range of clocks, the minimum is used.
+    u32 TransferClocks = BUS_CYCLE_CLOCKS*Timing.Transfers;
+    u32 InternalClocks = (Timing.Base.Min > TransferClocks) ? (Timing.Base.Min - TransferClocks) : 0;
+    u32 BusCyclesPerTransfer = 1;
+    if((Instruction.Flags & Inst_Wide) && (State.Assume8088 || State.AssumeAddressUnanaligned))
+    {
+        BusCyclesPerTransfer = 2;
+    }
+    
+    RunInternalClocks(Bus, Timing.EAClocks);
+    if(Timing.Transfers)
+    {
+        RunBusTransfer(Bus, BusCyclesPerTransfer);
+    }
+    RunInternalClocks(Bus, InternalClocks);
+    if(Timing.Transfers > 1)
+    {
+        RunBusTransfer(Bus, BusCyclesPerTransfer*(Timing.Transfers - 1));
+    }
+    
+    // NOTE(agent): Anything that did not continue at the next sequential address flushes the queue.
+    // A prefetch already in progress still ties up the bus, but its bytes are thrown away.
+    u32 SequentialAddress = (Instruction.Address + Instruction.Size) & 0xfffff;
+    if(NextAddress != SequentialAddress)
+    {
+        Bus->QueueBytes = 0;
+        Bus->FetchBytes = 0;
+        Bus->FetchAddress = NextAddress;
+    }
+    
+    // NOTE(agent): Whatever the bus does after the execution unit finishes overlaps with the next
+    // instruction, so it is counted there if the next instruction ends up waiting on it.
+    instruction_clock_interval Result = {};
+    Result.Min = Result.Max = (u32)(Bus->Clock - StartClock);
+    return Result;
+}
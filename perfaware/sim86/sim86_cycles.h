@@ -35,3 +35,26 @@ struct timing_state
 static instruction_timing EstimateInstructionClocks(timing_state State, instruction Instruction);
 static void UpdateTimingForExec(timing_state *State, exec_result Exec);
 static instruction_clock_interval ExpectedClocksFrom(timing_state State, instruction Instruction, instruction_timing Timing);
+
+// NOTE(agent): The bus model is an optional, more detailed alternative to ExpectedClocksFrom. Instead of
+// assuming every instruction is already sitting in the prefetch queue, it tracks the queue and the bus
+// across instructions, so instruction fetch competes with the memory transfers the instructions make.
+#define BUS_CYCLE_CLOCKS 4
+
+struct bus_state
+{
+    u32 QueueSize;
+    b32 ByteBus;
+    
+    u32 QueueBytes;
+    u32 FetchAddress;
+    
+    u32 FetchClocksLeft;
+    u32 FetchBytes;
+    
+    u64 Clock;
+};
+
+static void ResetBusState(bus_state *Bus, b32 Assume8088, u32 StartAddress);
+static instruction_clock_interval SimulateBusClocks(bus_state *Bus, timing_state State, instruction Instruction,
+                                                    instruction_timing Timing, u32 NextAddress);
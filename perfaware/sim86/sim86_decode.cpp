@@ -16,6 +16,33 @@ struct decode_context
     u32 AdditionalFlags;
 };
 
+// NOTE(agent): The dispatch key is the first instruction byte, plus the 3 bits of the second byte
+// where the 8086 puts the REG field. The "group" opcodes (0x80, 0xf6, 0xff, etc.) use those 3 bits
+// as an opcode extension, so including them means most keys map to exactly one encoding.
+#define DECODE_DISPATCH_KEY_COUNT (256*8)
+#define MAX_DECODE_CANDIDATES 8
+
+struct decode_candidates
+{
+    u8 Count;
+    u8 EncodingIndex[MAX_DECODE_CANDIDATES];
+};
+
+struct decode_dispatch
+{
+    decode_candidates Keys[DECODE_DISPATCH_KEY_COUNT];
+};
+
+typedef instruction try_decode_function(decode_context *Context, instruction_encoding *Inst, segmented_access At);
+
+// NOTE(agent): Defined in sim86_decode_compiled.cpp. Returns one decode function per encoding in Table,
+// or 0 if there are no compiled decoders for Table.
+static try_decode_function *const *GetCompiledDecoders(instruction_table Table);
+
+// NOTE(agent): Also defined in sim86_decode_compiled.cpp, where the dispatch table for the 8086 table is
+// built at compile time. Returns 0 for any other table, which is then decoded by scanning every entry.
+static decode_dispatch const *GetDecodeDispatch(instruction_table Table);
+
 static instruction_operand GetRegOperand(u32 IntelRegIndex, b32 Wide)
 {
     // NOTE(casey): This maps Intel's REG and RM field encodings for registers to our encoding for registers.
@@ -68,6 +95,131 @@ static u32 ParseDataValue(segmented_access *Access, b32 Exists, b32 Wide, b32 Si
     return Result;
 }
 
+static instruction FinishDecode(decode_context *Context, operation_type Op, segmented_access At, u32 StartingAddress,
+                               b32 const *Has, u32 *Bits)
+{
+    // NOTE(agent): This turns the fields pulled out of the opcode bits into an instruction. At points
+    // just past the opcode bits, so it is where the displacement and data (if any) start.
+    instruction Dest = {};
+    
+    u32 Mod = Bits[Bits_MOD];
+    u32 RM = Bits[Bits_RM];
+    u32 W = Bits[Bits_W];
+    b32 S = Bits[Bits_S];
+    b32 D = Bits[Bits_D];
+    
+    b32 HasDirectAddress = ((Mod == 0b00) && (RM == 0b110));
+    b32 HasDisp = ((Has[Bits_Disp]) || (Mod == 0b10) || (Mod == 0b01) || HasDirectAddress);
+    
+    b32 DisplacementIsW = ((Bits[Bits_DispAlwaysW]) || (Mod == 0b10) || HasDirectAddress);
+    b32 DataIsW = ((Bits[Bits_WMakesDataW]) && !S && W);
+    
+    Bits[Bits_Disp] |= ParseDataValue(&At, HasDisp, DisplacementIsW, (!DisplacementIsW));
+    Bits[Bits_Data] |= ParseDataValue(&At, Has[Bits_Data], DataIsW, S);
+    
+    Dest.Op = Op;
+    Dest.Flags = Context->AdditionalFlags;
+    Dest.Address = StartingAddress;
+    Dest.Size = GetAbsoluteAddressOf(At) - StartingAddress;
+    Dest.SegmentOverride = Context->DefaultSegment;
+    
+    if(W)
+    {
+        Dest.Flags |= Inst_Wide;
+    }
+    
+    if(Bits[Bits_Far])
+    {
+        Dest.Flags |= Inst_Far;
+    }
+    
+    if(Bits[Bits_Z])
+    {
+        Dest.Flags |= Inst_RepNE;
+    }
+    
+    u32 Disp = Bits[Bits_Disp];
+    s16 Displacement = (s16)Disp;
+    
+    instruction_operand *RegOperand = &Dest.Operands[D ? 0 : 1];
+    instruction_operand *ModOperand = &Dest.Operands[D ? 1 : 0];
+    
+    if(Has[Bits_SR])
+    {
+        *RegOperand = RegisterOperand(Register_es + (Bits[Bits_SR] & 0x3), 2);
+    }
+    
+    if(Has[Bits_REG])
+    {
+        *RegOperand = GetRegOperand(Bits[Bits_REG], W);
+    }
+    
+    if(Has[Bits_MOD])
+    {
+        if(Mod == 0b11)
+        {
+            *ModOperand = GetRegOperand(RM, W || (Bits[Bits_RMRegAlwaysW]));
+        }
+        else
+        {
+            register_mapping_8086 IntelTerm0[8] = { Register_b,  Register_b, Register_bp, Register_bp, Register_si, Register_di, Register_bp, Register_b};
+            register_mapping_8086 IntelTerm1[8] = {Register_si, Register_di, Register_si, Register_di};
+            
+            u32 I = RM&0x7;
+            register_mapping_8086 Term0 = IntelTerm0[I];
+            register_mapping_8086 Term1 = IntelTerm1[I];
+            if((Mod == 0b00) && (RM == 0b110))
+            {
+                Term0 = {};
+                Term1 = {};
+            }
+            
+            *ModOperand = EffectiveAddressOperand(RegisterAccess(Term0, 0, 2), RegisterAccess(Term1, 0, 2), Displacement);
+        }
+    }
+    
+    if(Has[Bits_Data] && HasDisp && !Has[Bits_MOD])
+    {
+        Dest.Operands[0] = IntersegmentAddressOperand(Bits[Bits_Data], Bits[Bits_Disp]);
+    }
+    else
+    {
+        //
+        // NOTE(casey): Because there are some strange opcodes that do things like have an immediate as
+        // a _destination_ ("out", for example), I define immediates and other "additional operands" to
+        // go in "whatever slot was not used by the reg and mod fields".
+        //
+        
+        instruction_operand *LastOperand = &Dest.Operands[0];
+        if(LastOperand->Type)
+        {
+            LastOperand = &Dest.Operands[1];
+        }
+        
+        if(Bits[Bits_RelJMPDisp])
+        {
+            *LastOperand = ImmediateOperand(Displacement, Immediate_RelativeJumpDisplacement);
+        }
+        else if(Has[Bits_Data])
+        {
+            *LastOperand = ImmediateOperand(Bits[Bits_Data]);
+        }
+        else if(Has[Bits_V])
+        {
+            if(Bits[Bits_V])
+            {
+                *LastOperand = RegisterOperand(Register_c, 1);
+            }
+            else
+            {
+                *LastOperand = ImmediateOperand(1);
+            }
+        }
+    }
+    
+    return Dest;
+}
+
 static instruction TryDecode(decode_context *Context, instruction_encoding *Inst, segmented_access At)
 {
     instruction Dest = {};
@@ -75,7 +227,7 @@ static instruction TryDecode(decode_context *Context, instruction_encoding *Inst
     u32 Bits[Bits_Count] = {};
     b32 Valid = true;
     
-    u64 StartingAddress = GetAbsoluteAddressOf(At);
+    u32 StartingAddress = GetAbsoluteAddressOf(At);
     
     u8 BitsPendingCount = 0;
     u8 BitsPending = 0;
@@ -123,133 +275,56 @@ static instruction TryDecode(decode_context *Context, instruction_encoding *Inst
     
     if(Valid)
     {
-        u32 Mod = Bits[Bits_MOD];
-        u32 RM = Bits[Bits_RM];
-        u32 W = Bits[Bits_W];
-        b32 S = Bits[Bits_S];
-        b32 D = Bits[Bits_D];
-        
-        b32 HasDirectAddress = ((Mod == 0b00) && (RM == 0b110));
-        Has[Bits_Disp] = ((Has[Bits_Disp]) || (Mod == 0b10) || (Mod == 0b01) || HasDirectAddress);
+        Dest = FinishDecode(Context, Inst->Op, At, StartingAddress, Has, Bits);
+    }
+    
+    return Dest;
+}
 
-        b32 DisplacementIsW = ((Bits[Bits_DispAlwaysW]) || (Mod == 0b10) || HasDirectAddress);
-        b32 DataIsW = ((Bits[Bits_WMakesDataW]) && !S && W);
-        
-        Bits[Bits_Disp] |= ParseDataValue(&At, Has[Bits_Disp], DisplacementIsW, (!DisplacementIsW));
-        Bits[Bits_Data] |= ParseDataValue(&At, Has[Bits_Data], DataIsW, S);
-        
-        Dest.Op = Inst->Op;
-        Dest.Flags = Context->AdditionalFlags;
-        Dest.Address = StartingAddress;
-        Dest.Size = GetAbsoluteAddressOf(At) - StartingAddress;
-        Dest.SegmentOverride = Context->DefaultSegment;
-        
-        if(W)
-        {
-            Dest.Flags |= Inst_Wide;
-        }
+static u16 DispatchKeyFor(u8 Byte0, u8 Byte1)
+{
+    u16 Result = (u16)((Byte0 << 3) | ((Byte1 >> 3) & 0x7));
+    return Result;
+}
 
-        if(Bits[Bits_Far])
-        {
-            Dest.Flags |= Inst_Far;
-        }
-        
-        if(Bits[Bits_Z])
-        {
-            Dest.Flags |= Inst_RepNE;
-        }
-        
-        u32 Disp = Bits[Bits_Disp];
-        s16 Displacement = (s16)Disp;
-        
-        instruction_operand *RegOperand = &Dest.Operands[D ? 0 : 1];
-        instruction_operand *ModOperand = &Dest.Operands[D ? 1 : 0];
-        
-        if(Has[Bits_SR])
-        {
-            *RegOperand = RegisterOperand(Register_es + (Bits[Bits_SR] & 0x3), 2);
-        }
-        
-        if(Has[Bits_REG])
-        {
-            *RegOperand = GetRegOperand(Bits[Bits_REG], W);
-        }
-        
-        if(Has[Bits_MOD])
+static instruction TryDecodeAnyOf(decode_context *Context, instruction_table Table, decode_dispatch const *Dispatch,
+                                  try_decode_function *const *Decoders, segmented_access At)
+{
+    instruction Result = {};
+    
+    if(Dispatch)
+    {
+        decode_candidates const *Candidates = &Dispatch->Keys[DispatchKeyFor(*AccessMemory(At, 0), *AccessMemory(At, 1))];
+        for(u32 CandidateIndex = 0; CandidateIndex < Candidates->Count; ++CandidateIndex)
         {
-            if(Mod == 0b11)
-            {
-                *ModOperand = GetRegOperand(RM, W || (Bits[Bits_RMRegAlwaysW]));
-            }
-            else
+            u32 EncodingIndex = Candidates->EncodingIndex[CandidateIndex];
+            instruction_encoding *Inst = Table.Encodings + EncodingIndex;
+            Result = Decoders ? Decoders[EncodingIndex](Context, Inst, At) : TryDecode(Context, Inst, At);
+            if(Result.Op)
             {
-                register_mapping_8086 IntelTerm0[8] = { Register_b,  Register_b, Register_bp, Register_bp, Register_si, Register_di, Register_bp, Register_b};
-                register_mapping_8086 IntelTerm1[8] = {Register_si, Register_di, Register_si, Register_di};
-                
-                u32 I = RM&0x7;
-                register_mapping_8086 Term0 = IntelTerm0[I];
-                register_mapping_8086 Term1 = IntelTerm1[I];
-                if((Mod == 0b00) && (RM == 0b110))
-                {
-                    Term0 = {};
-                    Term1 = {};
-                }
-                
-                *ModOperand = EffectiveAddressOperand(RegisterAccess(Term0, 0, 2), RegisterAccess(Term1, 0, 2), Displacement);
+                break;
             }
         }
-        
-        if(Has[Bits_Data] && Has[Bits_Disp] && !Has[Bits_MOD])
-        {
-            Dest.Operands[0] = IntersegmentAddressOperand(Bits[Bits_Data], Bits[Bits_Disp]);
-        }
-        else
+    }
+    else
+    {
+        for(u32 Index = 0; Index < Table.EncodingCount; ++Index)
         {
-            //
-            // NOTE(casey): Because there are some strange opcodes that do things like have an immediate as
-            // a _destination_ ("out", for example), I define immediates and other "additional operands" to
-            // go in "whatever slot was not used by the reg and mod fields".
-            //
-            
-            instruction_operand *LastOperand = &Dest.Operands[0];
-            if(LastOperand->Type)
-            {
-                LastOperand = &Dest.Operands[1];
-            }
-            
-            if(Bits[Bits_RelJMPDisp])
-            {
-                *LastOperand = ImmediateOperand(Displacement, Immediate_RelativeJumpDisplacement);
-            }
-            else if(Has[Bits_Data])
-            {
-                *LastOperand = ImmediateOperand(Bits[Bits_Data]);
-            }
-            else if(Has[Bits_V])
+            instruction_encoding Inst = Table.Encodings[Index];
+            Result = TryDecode(Context, &Inst, At);
+            if(Result.Op)
             {
-                if(Bits[Bits_V])
-                {
-                    *LastOperand = RegisterOperand(Register_c, 1);
-                }
-                else
-                {
-                    *LastOperand = ImmediateOperand(1);
-                }
+                break;
             }
         }
     }
     
-    return Dest;
+    return Result;
 }
 
-static instruction DecodeInstruction(instruction_table Table, segmented_access At)
+static instruction DecodeInstructionWith(instruction_table Table, decode_dispatch const *Dispatch,
+                                         try_decode_function *const *Decoders, segmented_access At)
 {
-    /* TODO(casey): Hmm. It seems like this is a very inefficient way to parse
-       instructions, isn't it? For every instruction, we check every entry in the
-       table until we find a match. Is this bad design? Or did the person who wrote
-       it know what they were doing, and has a plan for how it can be optimized
-       later? Only time will tell... :) */
-    
     decode_context Context = {};
     instruction Result = {};
     
@@ -257,17 +332,11 @@ static instruction DecodeInstruction(instruction_table Table, segmented_access A
     u32 TotalSize = 0;
     while(TotalSize < Table.MaxInstructionByteCount)
     {
-        Result = {};
-        for(u32 Index = 0; Index < Table.EncodingCount; ++Index)
+        Result = TryDecodeAnyOf(&Context, Table, Dispatch, Decoders, At);
+        if(Result.Op)
         {
-            instruction_encoding Inst = Table.Encodings[Index];
-            Result = TryDecode(&Context, &Inst, At);
-            if(Result.Op)
-            {
-                At.SegmentOffset += Result.Size;
-                TotalSize += Result.Size;
-                break;
-            }
+            At.SegmentOffset += Result.Size;
+            TotalSize += Result.Size;
         }
         
         if(Result.Op == Op_lock)
@@ -301,3 +370,9 @@ static instruction DecodeInstruction(instruction_table Table, segmented_access A
     
     return Result;
 }
+
+static instruction DecodeInstruction(instruction_table Table, segmented_access At)
+{
+    instruction Result = DecodeInstructionWith(Table, GetDecodeDispatch(Table), GetCompiledDecoders(Table), At);
+    return Result;
+}
@@ -0,0 +1,75 @@
+/* ========================================================================
+
+   sim86_decode_cache.cpp - Decoded instruction cache for Run8086
+
+   ======================================================================== */
+
+static void ResetDecodeCache(decode_cache *Cache)
+{
+    memset(Cache, 0, sizeof(*Cache));
+}
+
+static decode_cache_entry *GetDecodeCacheEntry(decode_cache *Cache, u32 AbsAddr)
+{
+    decode_cache_entry *Result = Cache->Entries + (AbsAddr & ((1 << DECODE_CACHE_SIZE_POW2) - 1));
+    return Result;
+}
+
+static instruction DecodeInstructionCached(decode_cache *Cache, instruction_table Table, segmented_access At)
+{
+    instruction Result = {};
+    
+    u32 AbsAddr = GetAbsoluteAddressOf(At);
+    decode_cache_entry *Entry = GetDecodeCacheEntry(Cache, AbsAddr);
+    if(Entry->Tag == (AbsAddr + 1))
+    {
+        Result = Entry->Instruction;
+        ++Cache->Hits;
+    }
+    else
+    {
+        Result = DecodeInstruction(Table, At);
+        ++Cache->Misses;
+        
+        // NOTE(agent): Failed decodes are not cached, since the simulation stops on them anyway.
+        if(Result.Op)
+        {
+            Entry->Tag = AbsAddr + 1;
+            Entry->Instruction = Result;
+            WatchMemory(&Cache->Tracker, AbsAddr, Result.Size);
+        }
+    }
+    
+    return Result;
+}
+
+static void InvalidateWrittenCode(decode_cache *Cache, instruction_table Table)
+{
+    memory_tracker *Tracker = &Cache->Tracker;
+    if(Tracker->WatchedPageWritten)
+    {
+        // NOTE(agent): Any instruction that starts up to MaxInstructionByteCount-1 bytes before the
+        // lowest written address might overlap the write, so those have to be checked too.
+        u32 Low = Tracker->WatchedWriteLow;
+        u32 High = Tracker->WatchedWriteHigh;
+        u32 First = (Low >= (Table.MaxInstructionByteCount - 1)) ? (Low - (Table.MaxInstructionByteCount - 1)) : 0;
+        
+        // NOTE(agent): If the range is bigger than the cache, visiting every entry once is enough.
+        u32 EntryCount = ArrayCount(Cache->Entries);
+        u32 CheckCount = ((High - First) < EntryCount) ? (High - First + 1) : EntryCount;
+        for(u32 CheckIndex = 0; CheckIndex < CheckCount; ++CheckIndex)
+        {
+            decode_cache_entry *Entry = GetDecodeCacheEntry(Cache, First + CheckIndex);
+            u32 EntryAddr = Entry->Tag - 1;
+            if(Entry->Tag &&
+               (EntryAddr >= First) && (EntryAddr <= High) &&
+               ((EntryAddr + Entry->Instruction.Size) > Low))
+            {
+                Entry->Tag = 0;
+                ++Cache->Invalidations;
+            }
+        }
+        
+        Tracker->WatchedPageWritten = false;
+    }
+}
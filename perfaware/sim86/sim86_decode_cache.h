@@ -0,0 +1,27 @@
+/* ========================================================================
+
+   sim86_decode_cache.h - Decoded instruction cache for Run8086
+
+   ======================================================================== */
+
+#define DECODE_CACHE_SIZE_POW2 12
+
+struct decode_cache_entry
+{
+    u32 Tag; // NOTE(agent): Absolute address + 1, so that 0 means "empty"
+    instruction Instruction;
+};
+
+struct decode_cache
+{
+    decode_cache_entry Entries[1 << DECODE_CACHE_SIZE_POW2];
+    memory_tracker Tracker;
+    
+    u64 Hits;
+    u64 Misses;
+    u64 Invalidations;
+};
+
+static void ResetDecodeCache(decode_cache *Cache);
+static instruction DecodeInstructionCached(decode_cache *Cache, instruction_table Table, segmented_access At);
+static void InvalidateWrittenCode(decode_cache *Cache, instruction_table Table);
@@ -0,0 +1,265 @@
+/* ========================================================================
+
+   sim86_decode_compiled.cpp - Per-encoding decode functions generated from the instruction table at compile time
+
+   ======================================================================== */
+
+/* NOTE(agent): TryDecode interprets an instruction_encoding bit field by bit field every time it is
+   called. Since the 8086 table never changes, this file includes the table a second time as constexpr
+   data, and turns every encoding into its own decode function. The layout of each encoding (which
+   bytes hold which fields, and which bits must match) is worked out at compile time, so each function
+   is just a couple of masked compares followed by fixed shifts and masks.
+   
+   The interpreted decoder (DecodeInstructionInterpreted in sim86_bench.cpp) is kept as the
+   reference - sim86_bench -verify checks that the two agree.
+*/
+
+#define MAX_COMPILED_OPCODE_BYTES 2
+#define MAX_COMPILED_FIELDS 16
+
+struct compiled_field
+{
+    instruction_bits_usage Usage;
+    u8 Byte;
+    u8 SourceShift;
+    u8 Mask;
+    u8 DestShift;
+};
+
+struct compiled_encoding
+{
+    operation_type Op;
+    
+    // NOTE(agent): The opcode bytes, and the bits in them that have to match for this encoding
+    u32 ByteCount;
+    u8 LiteralMask[MAX_COMPILED_OPCODE_BYTES];
+    u8 LiteralValue[MAX_COMPILED_OPCODE_BYTES];
+    
+    // NOTE(agent): Which fields the encoding has, the values of the implicit ones, and where the
+    // explicit ones are in the opcode bytes
+    b32 Has[Bits_Count];
+    u32 Implicit[Bits_Count];
+    u32 FieldCount;
+    compiled_field Fields[MAX_COMPILED_FIELDS];
+};
+
+static constexpr instruction_encoding CompiledInstructionTable8086[] =
+{
+#include "sim86_instruction_table.inl"
+};
+
+static constexpr compiled_encoding CompileEncoding(instruction_encoding Inst)
+{
+    // NOTE(agent): This walks the bits exactly the way TryDecode does, but records where things are
+    // instead of reading them.
+    compiled_encoding Result = {};
+    Result.Op = Inst.Op;
+    
+    u32 BitsPendingCount = 0;
+    for(u32 BitsIndex = 0; BitsIndex < ArrayCount(Inst.Bits); ++BitsIndex)
+    {
+        instruction_bits TestBits = Inst.Bits[BitsIndex];
+        if(TestBits.Usage == Bits_End)
+        {
+            break;
+        }
+        
+        if(TestBits.BitCount == 0)
+        {
+            Result.Has[TestBits.Usage] = true;
+            Result.Implicit[TestBits.Usage] |= (TestBits.Value << TestBits.Shift);
+        }
+        else
+        {
+            if(BitsPendingCount == 0)
+            {
+                BitsPendingCount = 8;
+                ++Result.ByteCount;
+            }
+            
+            BitsPendingCount -= TestBits.BitCount;
+            
+            u32 Byte = Result.ByteCount - 1;
+            u8 Mask = (u8)((1 << TestBits.BitCount) - 1);
+            if(TestBits.Usage == Bits_Literal)
+            {
+                Result.LiteralMask[Byte] |= (u8)(Mask << BitsPendingCount);
+                Result.LiteralValue[Byte] |= (u8)(TestBits.Value << BitsPendingCount);
+            }
+            else
+            {
+                Result.Has[TestBits.Usage] = true;
+                
+                compiled_field *Field = &Result.Fields[Result.FieldCount++];
+                Field->Usage = TestBits.Usage;
+                Field->Byte = (u8)Byte;
+                Field->SourceShift = (u8)BitsPendingCount;
+                Field->Mask = Mask;
+                Field->DestShift = TestBits.Shift;
+            }
+        }
+    }
+    
+    return Result;
+}
+
+template<u32 EncodingIndex>
+static instruction TryDecodeCompiled(decode_context *Context, instruction_encoding *Inst, segmented_access At)
+{
+    static constexpr compiled_encoding Encoding = CompileEncoding(CompiledInstructionTable8086[EncodingIndex]);
+    static_assert(Encoding.ByteCount <= MAX_COMPILED_OPCODE_BYTES, "Encoding has too many opcode bytes");
+    
+    instruction Result = {};
+    
+    u8 Bytes[MAX_COMPILED_OPCODE_BYTES] = {};
+    b32 Valid = true;
+    for(u32 ByteIndex = 0; ByteIndex < Encoding.ByteCount; ++ByteIndex)
+    {
+        Bytes[ByteIndex] = *AccessMemory(At, ByteIndex);
+        Valid = Valid && ((Bytes[ByteIndex] & Encoding.LiteralMask[ByteIndex]) == Encoding.LiteralValue[ByteIndex]);
+    }
+    
+    if(Valid)
+    {
+        u32 Bits[Bits_Count];
+        for(u32 Usage = 0; Usage < Bits_Count; ++Usage)
+        {
+            Bits[Usage] = Encoding.Implicit[Usage];
+        }
+        
+        for(u32 FieldIndex = 0; FieldIndex < Encoding.FieldCount; ++FieldIndex)
+        {
+            compiled_field Field = Encoding.Fields[FieldIndex];
+            Bits[Field.Usage] |= (((Bytes[Field.Byte] >> Field.SourceShift) & Field.Mask) << Field.DestShift);
+        }
+        
+        u32 StartingAddress = GetAbsoluteAddressOf(At);
+        At.SegmentOffset += Encoding.ByteCount;
+        Result = FinishDecode(Context, Encoding.Op, At, StartingAddress, Encoding.Has, Bits);
+    }
+    
+    return Result;
+}
+
+// NOTE(agent): __COUNTER__ gives each INST in the table its index, so this second expansion of the table
+// makes one TryDecodeCompiled per encoding, in table order.
+enum
+{
+    CompiledDecoderCounterBase = __COUNTER__ + 1,
+};
+
+static try_decode_function *const CompiledDecoders8086[] =
+{
+#define INST(Mnemonic, ...) &TryDecodeCompiled<__COUNTER__ - CompiledDecoderCounterBase>,
+#define INSTALT INST
+#include "sim86_instruction_table.inl"
+};
+
+static_assert(ArrayCount(CompiledDecoders8086) == ArrayCount(CompiledInstructionTable8086), "Compiled decoders do not match the table");
+static_assert(ArrayCount(CompiledInstructionTable8086) == ArrayCount(InstructionTable8086), "Compiled table does not match the table");
+
+static try_decode_function *const *GetCompiledDecoders(instruction_table Table)
+{
+    // NOTE(agent): The compiled decoders only exist for the built-in 8086 table.
+    try_decode_function *const *Result = 0;
+    if(Table.Encodings == InstructionTable8086)
+    {
+        Result = CompiledDecoders8086;
+    }
+    
+    return Result;
+}
+
+static constexpr decode_dispatch BuildDecodeDispatch8086(void)
+{
+    // NOTE(agent): The dispatch table only ever _filters_ the encodings. TryDecode still checks every
+    // bit of every candidate, and candidates are kept in table order, so the first match is the same
+    // one the full table scan would have found.
+    decode_dispatch Result = {};
+    
+    for(u32 Index = 0; Index < ArrayCount(CompiledInstructionTable8086); ++Index)
+    {
+        instruction_encoding Inst = CompiledInstructionTable8086[Index];
+        
+        // NOTE(agent): Gather the literal bits from the first two bytes into a 16-bit pattern,
+        // with the first byte in the high 8 bits.
+        u32 LiteralMask = 0;
+        u32 LiteralValue = 0;
+        u32 BitPosition = 0;
+        for(u32 BitsIndex = 0; BitsIndex < ArrayCount(Inst.Bits); ++BitsIndex)
+        {
+            instruction_bits TestBits = Inst.Bits[BitsIndex];
+            if(TestBits.Usage == Bits_End)
+            {
+                break;
+            }
+            
+            if(TestBits.BitCount != 0)
+            {
+                BitPosition += TestBits.BitCount;
+                if((TestBits.Usage == Bits_Literal) && (BitPosition <= 16))
+                {
+                    u32 Shift = 16 - BitPosition;
+                    LiteralMask |= ((1 << TestBits.BitCount) - 1) << Shift;
+                    LiteralValue |= (u32)TestBits.Value << Shift;
+                }
+            }
+        }
+        
+        // NOTE(agent): Only the REG position of the second byte is part of the key, so any other
+        // literal bits there are left for TryDecode to check. In key order that is the first byte
+        // followed by those 3 bits, like DispatchKeyFor.
+        u32 KeyMask = ((LiteralMask >> 8) << 3) | ((LiteralMask >> 3) & 0x7);
+        u32 KeyValue = (((LiteralValue >> 8) << 3) | ((LiteralValue >> 3) & 0x7)) & KeyMask;
+        u32 FreeBits = ~KeyMask & (DECODE_DISPATCH_KEY_COUNT - 1);
+        
+        // NOTE(agent): Visit every key that matches, by counting through the bits that aren't literal.
+        u32 Free = 0;
+        for(;;)
+        {
+            decode_candidates *Candidates = &Result.Keys[KeyValue | Free];
+            if(Candidates->Count < ArrayCount(Candidates->EncodingIndex))
+            {
+                Candidates->EncodingIndex[Candidates->Count] = (u8)Index;
+            }
+            ++Candidates->Count;
+            
+            if(Free == FreeBits)
+            {
+                break;
+            }
+            Free = (Free - FreeBits) & FreeBits;
+        }
+    }
+    
+    return Result;
+}
+
+static constexpr b32 DecodeDispatchFits(decode_dispatch const &Dispatch)
+{
+    b32 Result = true;
+    for(u32 Key = 0; Key < DECODE_DISPATCH_KEY_COUNT; ++Key)
+    {
+        Result = Result && (Dispatch.Keys[Key].Count <= MAX_DECODE_CANDIDATES);
+    }
+    
+    return Result;
+}
+
+// NOTE(agent): Since this is built by the compiler, there is nothing to initialize at run time, and
+// any number of threads can decode at once.
+static constexpr decode_dispatch DecodeDispatch8086 = BuildDecodeDispatch8086();
+
+static_assert(ArrayCount(CompiledInstructionTable8086) <= 256, "Encoding indices no longer fit in a u8");
+static_assert(DecodeDispatchFits(DecodeDispatch8086), "A dispatch key has more than MAX_DECODE_CANDIDATES encodings");
+
+static decode_dispatch const *GetDecodeDispatch(instruction_table Table)
+{
+    decode_dispatch const *Result = 0;
+    if(Table.Encodings == InstructionTable8086)
+    {
+        Result = &DecodeDispatch8086;
+    }
+    
+    return Result;
+}
@@ -0,0 +1,860 @@
+/* ========================================================================
+
+   sim86_difftest.cpp - Lockstep differential tester between sim86 and the cg/disasm simulator
+
+   ======================================================================== */
+
+/* NOTE(agent): sim86_difftest runs the same program through sim86 (DecodeInstruction/ExecInstruction)
+   and through the cg/disasm simulator (sim_step) in lockstep, and stops at the first instruction
+   after which the two disagree about the general registers, ip, or the status flags. With
+   -keepgoing it instead copies sim86's registers into cg at each divergence and carries on, so a
+   bug cg is known to have (see -ignoreflags) doesn't hide everything after it.
+   
+   Programs either come from files, or are generated with -random: each random stream is made only
+   from instructions both simulators decode (mov/add/sub/cmp on registers and immediates), and is
+   determined entirely by its seed, so a divergence can always be replayed with "-seed S -random 1".
+   The first diverging stream is also written out as sim86_difftest_S.bin, which can be handed back
+   to sim86_difftest, or to sim86 -exec, as an ordinary program.
+   
+   The cg simulator keeps segment registers in its memory rather than in its register file, so
+   segment registers are not compared.
+*/
+
+#include "sim86.h"
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <assert.h>
+
+#include "sim86_instruction.h"
+#include "sim86_instruction_table.h"
+#include "sim86_memory.h"
+#include "sim86_decode.h"
+#include "sim86_execute.h"
+#include "sim86_cycles.h"
+#include "sim86_text.h"
+#include "sim86_platform.h"
+
+#include "sim86_instruction.cpp"
+#include "sim86_instruction_table.cpp"
+#include "sim86_memory.cpp"
+#include "sim86_decode.cpp"
+#include "sim86_decode_compiled.cpp"
+#include "sim86_execute.cpp"
+#include "sim86_text_table.cpp"
+#include "sim86_text.cpp"
+#include "sim86_platform.cpp"
+
+/* NOTE(agent): The cg simulator has its own u8/s8/etc. typedefs which do not agree with ours (s8 is
+   signed char there, char here), so it is compiled inside its own namespace. Its system headers
+   are all included above, so their include guards keep them out of the namespace. cg also
+   replaces assert with its own, which is fine since all of our code has been included by now.
+*/
+#if _WIN32
+#include <intrin.h>
+#endif
+#undef assert
+namespace cg
+{
+#include "../cg/disasm/types.h"
+#include "../cg/disasm/mem.h"
+#include "../cg/disasm/string.h"
+#include "../cg/disasm/instruction.h"
+#include "../cg/disasm/sim.h"
+#include "../cg/disasm/os.h"
+
+#include "../cg/disasm/mem.cpp"
+#include "../cg/disasm/string.cpp"
+#include "../cg/disasm/instruction.cpp"
+#include "../cg/disasm/sim.cpp"
+#include "../cg/disasm/os.cpp"
+}
+
+// NOTE(agent): Status flags the cg simulator models, and the bit it keeps each of them in.
+struct model_flag
+{
+    u16 Flag;
+    cg::flag_t ModelFlag;
+    char Letter; // NOTE(agent): As PrintFlags writes it, and as -ignoreflags takes it
+};
+static model_flag const ModelFlags[] =
+{
+    {Flag_CF, cg::FLAG_CARRY, 'C'},
+    {Flag_PF, cg::FLAG_PARITY, 'P'},
+    {Flag_AF, cg::FLAG_AUXILIARY_CARRY, 'A'},
+    {Flag_ZF, cg::FLAG_ZERO, 'Z'},
+    {Flag_SF, cg::FLAG_SIGN, 'S'},
+    {Flag_OF, cg::FLAG_OVERFLOW, 'O'},
+};
+#define COMPARED_FLAGS (Flag_CF | Flag_PF | Flag_AF | Flag_ZF | Flag_SF | Flag_OF)
+
+// NOTE(agent): The cg register file is ax, bx, cx, dx, sp, bp, si, di.
+static register_index const ModelRegisters[8] =
+{
+    Register_a, Register_b, Register_c, Register_d, Register_sp, Register_bp, Register_si, Register_di,
+};
+
+#define DIFF_MEMORY_SIZE_POW2 20
+
+// NOTE(agent): cg's sim_load puts three int3 bytes after the program, so it needs that much room.
+#define DIFF_MAX_PROGRAM_SIZE ((1 << DIFF_MEMORY_SIZE_POW2) - 3)
+
+// NOTE(agent): Each random instruction is at most 4 bytes, and every stream starts by loading all
+// eight word registers with 3-byte movs.
+#define RANDOM_INSTRUCTION_MAX_SIZE 4
+#define RANDOM_STREAM_PROLOGUE_SIZE (8*3)
+
+struct diff_machine
+{
+    segmented_access Memory;
+    register_state_8086 Registers;
+    
+    cg::simulator_t Model;
+    
+    u32 ProgramSize;
+};
+
+enum diff_status
+{
+    Diff_Match,
+    Diff_Diverged,
+    Diff_StepLimit,
+    Diff_Undecodable,
+    Diff_Unimplemented,
+    Diff_ModelError,
+    
+    Diff_Count,
+};
+
+static char const *DiffStatusNames[Diff_Count] =
+{
+    "matched",
+    "diverged",
+    "hit the step limit",
+    "not decodable by sim86",
+    "unimplemented in sim86",
+    "rejected by cg",
+};
+
+struct diff_result
+{
+    diff_status Status;
+    u64 StepCount;
+    u64 DivergenceCount;
+    
+    // NOTE(agent): With -keepgoing, these describe the first divergence, not the last instruction.
+    instruction Instruction;
+    register_state_8086 Before;
+    register_state_8086 Expected; // NOTE(agent): sim86
+    register_state_8086 Got; // NOTE(agent): cg
+};
+
+struct diff_options
+{
+    u64 MaxSteps;
+    u16 FlagMask;
+    b32 KeepGoing;
+};
+
+struct random_batch
+{
+    diff_options Options;
+    u64 Seed;
+    u32 StreamCount;
+    u32 InstructionCount;
+    
+    u32 volatile NextStream;
+    u8 *Status;
+    u64 *DivergenceCounts;
+};
+
+struct random_worker
+{
+    os_thread Thread;
+    random_batch *Batch;
+    diff_machine *Machine;
+    u8 *Stream;
+};
+
+static diff_machine *CreateDiffMachine(void)
+{
+    diff_machine *Result = (diff_machine *)malloc(sizeof(diff_machine));
+    u8 *Memory = (u8 *)malloc(1 << DIFF_MEMORY_SIZE_POW2);
+    if(Result && Memory)
+    {
+        *Result = {};
+        Result->Memory = FixedMemoryPow2(DIFF_MEMORY_SIZE_POW2, Memory);
+        Result->Model.arena = cg::arena_create();
+        Result->Model.memory = (cg::u8 *)cg::arena_push_zero(Result->Model.arena, 1 << DIFF_MEMORY_SIZE_POW2);
+    }
+    else
+    {
+        free(Result);
+        free(Memory);
+        Result = 0;
+    }
+    
+    return Result;
+}
+
+static void LoadDiffProgram(diff_machine *Machine, u8 *Program, u32 ProgramSize)
+{
+    if(ProgramSize > DIFF_MAX_PROGRAM_SIZE)
+    {
+        ProgramSize = DIFF_MAX_PROGRAM_SIZE;
+    }
+    
+    // NOTE(agent): Both sides start from zeroed memory and registers, with the program at address 0.
+    memset(Machine->Memory.Memory, 0, 1 << DIFF_MEMORY_SIZE_POW2);
+    memcpy(Machine->Memory.Memory, Program, ProgramSize);
+    Machine->Registers = {};
+    Machine->ProgramSize = ProgramSize;
+    
+    // NOTE(agent): sim_reset is not used, because it also resets the arena the model's memory lives in.
+    cg::simulator_t *Model = &Machine->Model;
+    memset(Model->memory, 0, 1 << DIFF_MEMORY_SIZE_POW2);
+    memset(Model->registers, 0, sizeof(Model->registers));
+    Model->flags = 0;
+    Model->ip = 0;
+    Model->error.length = 0;
+    
+    cg::string_t Obj = {Program, ProgramSize};
+    cg::sim_load(Model, Obj);
+}
+
+static register_state_8086 GetModelRegisters(cg::simulator_t *Model)
+{
+    register_state_8086 Result = {};
+    
+    for(u32 Index = 0; Index < ArrayCount(ModelRegisters); ++Index)
+    {
+        Result.u16[ModelRegisters[Index]] = Model->registers[Index];
+    }
+    
+    for(u32 Index = 0; Index < ArrayCount(ModelFlags); ++Index)
+    {
+        if(Model->flags & (1 << ModelFlags[Index].ModelFlag))
+        {
+            Result.flags |= ModelFlags[Index].Flag;
+        }
+    }
+    
+    Result.ip = (u16)Model->ip;
+    
+    return Result;
+}
+
+// NOTE(agent): Puts sim86's registers into the model, so -keepgoing can carry on past a divergence
+// without it showing up again on every instruction after it. Memory is not copied back.
+static void SetModelRegisters(cg::simulator_t *Model, register_state_8086 *Registers)
+{
+    for(u32 Index = 0; Index < ArrayCount(ModelRegisters); ++Index)
+    {
+        Model->registers[Index] = Registers->u16[ModelRegisters[Index]];
+    }
+    
+    Model->flags = 0;
+    for(u32 Index = 0; Index < ArrayCount(ModelFlags); ++Index)
+    {
+        if(Registers->flags & ModelFlags[Index].Flag)
+        {
+            Model->flags |= (cg::u16)(1 << ModelFlags[Index].ModelFlag);
+        }
+    }
+    
+    Model->ip = Registers->ip;
+}
+
+// NOTE(agent): Clears everything in a register state that is not compared.
+static register_state_8086 ComparableRegisters(register_state_8086 Registers, u16 FlagMask)
+{
+    register_state_8086 Result = Registers;
+    
+    Result.es = Result.cs = Result.ss = Result.ds = 0;
+    Result.flags &= FlagMask;
+    
+    return Result;
+}
+
+static b32 RegistersMatch(register_state_8086 *A, register_state_8086 *B)
+{
+    b32 Result = true;
+    
+    for(u32 RegIndex = 0; RegIndex < ArrayCount(A->u16); ++RegIndex)
+    {
+        Result &= (A->u16[RegIndex] == B->u16[RegIndex]);
+    }
+    
+    return Result;
+}
+
+static diff_result RunLockstep(diff_machine *Machine, diff_options Options)
+{
+    diff_result Result = {};
+    
+    instruction_table Table = Get8086InstructionTable();
+    register_state_8086 *Registers = &Machine->Registers;
+    cg::simulator_t *Model = &Machine->Model;
+    
+    diff_status StopStatus = Diff_Match;
+    instruction Instruction = {};
+    while(Result.StepCount < Options.MaxSteps)
+    {
+        segmented_access At = Machine->Memory;
+        At.Mask = 0xffff;
+        SetSegmentBase(&At, Registers->cs);
+        At.SegmentOffset = Registers->ip;
+        if(GetAbsoluteAddressOf(At) >= Machine->ProgramSize)
+        {
+            break;
+        }
+        
+        Instruction = DecodeInstruction(Table, At);
+        if(!Instruction.Op)
+        {
+            StopStatus = Diff_Undecodable;
+            break;
+        }
+        
+        register_state_8086 Before = *Registers;
+        Registers->ip += Instruction.Size;
+        exec_result Exec = ExecInstruction(Machine->Memory, Registers, Instruction);
+        if(Exec.Unimplemented)
+        {
+            StopStatus = Diff_Unimplemented;
+            break;
+        }
+        
+        cg::sim_step(Model);
+        ++Result.StepCount;
+        if(Model->error.length)
+        {
+            StopStatus = Diff_ModelError;
+            break;
+        }
+        
+        register_state_8086 Expected = ComparableRegisters(*Registers, Options.FlagMask);
+        register_state_8086 Got = ComparableRegisters(GetModelRegisters(Model), Options.FlagMask);
+        if(!RegistersMatch(&Expected, &Got))
+        {
+            if(!Result.DivergenceCount++)
+            {
+                Result.Status = Diff_Diverged;
+                Result.Instruction = Instruction;
+                Result.Before = Before;
+                Result.Expected = Expected;
+                Result.Got = Got;
+            }
+            
+            if(!Options.KeepGoing)
+            {
+                break;
+            }
+            
+            SetModelRegisters(Model, Registers);
+        }
+    }
+    
+    if((StopStatus == Diff_Match) && (Result.StepCount >= Options.MaxSteps))
+    {
+        StopStatus = Diff_StepLimit;
+    }
+    
+    // NOTE(agent): A divergence is reported ahead of whatever stopped the run after it.
+    if(Result.Status == Diff_Match)
+    {
+        Result.Status = StopStatus;
+        Result.Instruction = Instruction;
+    }
+    
+    return Result;
+}
+
+static void PrintDiffResult(diff_result *Result, cg::simulator_t *Model, FILE *Dest)
+{
+    fprintf(Dest, "%s after %llu instructions", DiffStatusNames[Result->Status], Result->StepCount);
+    if(Result->Status == Diff_Match)
+    {
+        fprintf(Dest, "\n");
+    }
+    else
+    {
+        fprintf(Dest, ", at 0x%05x: ", Result->Instruction.Address);
+        if(Result->Status != Diff_Undecodable)
+        {
+            PrintInstruction(Result->Instruction, Dest);
+        }
+        if(Result->DivergenceCount > 1)
+        {
+            fprintf(Dest, " (first of %llu diverging instructions)", Result->DivergenceCount);
+        }
+        fprintf(Dest, "\n");
+    }
+    
+    if(Result->Status == Diff_ModelError)
+    {
+        fprintf(Dest, "    %.*s\n", (int)Model->error.length, (char *)Model->error.data);
+    }
+    else if(Result->Status == Diff_Diverged)
+    {
+        for(u32 RegIndex = 0; RegIndex < ArrayCount(Result->Expected.u16); ++RegIndex)
+        {
+            u16 Before = Result->Before.u16[RegIndex];
+            u16 Expected = Result->Expected.u16[RegIndex];
+            u16 Got = Result->Got.u16[RegIndex];
+            if(Expected != Got)
+            {
+                register_access Access = {};
+                Access.Index = RegIndex;
+                Access.Count = 2;
+                fprintf(Dest, "%8s: ", GetRegName(Access));
+                if(RegIndex == FLAGS_REGISTER_8086)
+                {
+                    fprintf(Dest, "before ");
+                    PrintFlags(Before, Dest);
+                    fprintf(Dest, ", sim86 ");
+                    PrintFlags(Expected, Dest);
+                    fprintf(Dest, ", cg ");
+                    PrintFlags(Got, Dest);
+                }
+                else
+                {
+                    fprintf(Dest, "before 0x%04x, sim86 0x%04x, cg 0x%04x", Before, Expected, Got);
+                }
+                fprintf(Dest, "\n");
+            }
+        }
+    }
+}
+
+static u64 NextRandom(u64 *Series)
+{
+    // NOTE(agent): xorshift64*, which is plenty for picking instructions.
+    u64 X = *Series;
+    X ^= X >> 12;
+    X ^= X << 25;
+    X ^= X >> 27;
+    *Series = X;
+    
+    u64 Result = X * 0x2545f4914f6cdd1dull;
+    return Result;
+}
+
+static u64 StreamSeed(u64 Seed, u32 StreamIndex)
+{
+    u64 Result = Seed + StreamIndex;
+    return Result;
+}
+
+static u32 GenerateRandomStream(u64 Seed, u32 InstructionCount, u8 *Dest)
+{
+    // NOTE(agent): xorshift never leaves zero, so the seed is mixed with a constant first.
+    u64 Series = (Seed ^ 0x9e3779b97f4a7c15ull) | 1;
+    u8 *At = Dest;
+    
+    for(u32 Reg = 0; Reg < 8; ++Reg)
+    {
+        u64 Value = NextRandom(&Series);
+        *At++ = (u8)(0xb8 + Reg);
+        *At++ = (u8)Value;
+        *At++ = (u8)(Value >> 8);
+    }
+    
+    // NOTE(agent): Only register and immediate forms are generated - cg reads and writes memory
+    // operands a byte at a time, and most jumps are missing from it.
+    static u8 const RegRegOps[] = {0x88, 0x00, 0x28, 0x38}; // NOTE(agent): mov, add, sub, cmp
+    static u8 const ImmedOps[] = {0, 5, 7}; // NOTE(agent): add, sub, cmp in the 0x80 group
+    static u8 const AccImmedOps[] = {0x04, 0x2c, 0x3c}; // NOTE(agent): add, sub, cmp
+    
+    for(u32 InstructionIndex = 0; InstructionIndex < InstructionCount; ++InstructionIndex)
+    {
+        u64 Pick = NextRandom(&Series);
+        u64 Value = NextRandom(&Series);
+        u8 W = (u8)((Pick >> 8) & 1);
+        u8 Reg = (u8)((Pick >> 9) & 7);
+        u8 RM = (u8)((Pick >> 12) & 7);
+        
+        switch(Pick % 4)
+        {
+            case 0:
+            {
+                *At++ = (u8)(0xb0 + (W << 3) + Reg);
+                *At++ = (u8)Value;
+                if(W)
+                {
+                    *At++ = (u8)(Value >> 8);
+                }
+            } break;
+            
+            case 1:
+            {
+                u8 D = (u8)((Pick >> 15) & 1);
+                *At++ = (u8)(RegRegOps[(Pick >> 16) % ArrayCount(RegRegOps)] | (D << 1) | W);
+                *At++ = (u8)(0xc0 | (Reg << 3) | RM);
+            } break;
+            
+            case 2:
+            {
+                // NOTE(agent): 0x80 is byte, 0x81 word, and 0x83 word with a sign-extended byte.
+                u8 SignExtend = W & (u8)((Pick >> 15) & 1);
+                *At++ = (u8)(0x80 | (SignExtend << 1) | W);
+                *At++ = (u8)(0xc0 | (ImmedOps[(Pick >> 16) % ArrayCount(ImmedOps)] << 3) | RM);
+                *At++ = (u8)Value;
+                if(W && !SignExtend)
+                {
+                    *At++ = (u8)(Value >> 8);
+                }
+            } break;
+            
+            case 3:
+            {
+                *At++ = (u8)(AccImmedOps[(Pick >> 16) % ArrayCount(AccImmedOps)] | W);
+                *At++ = (u8)Value;
+                if(W)
+                {
+                    *At++ = (u8)(Value >> 8);
+                }
+            } break;
+        }
+    }
+    
+    u32 Result = (u32)(At - Dest);
+    return Result;
+}
+
+static void RandomWorkerProc(void *Param)
+{
+    random_worker *Worker = (random_worker *)Param;
+    random_batch *Batch = Worker->Batch;
+    
+    for(;;)
+    {
+        u32 StreamIndex = AtomicIncrementU32(&Batch->NextStream) - 1;
+        if(StreamIndex >= Batch->StreamCount)
+        {
+            break;
+        }
+        
+        u32 StreamSize = GenerateRandomStream(StreamSeed(Batch->Seed, StreamIndex), Batch->InstructionCount,
+                                              Worker->Stream);
+        LoadDiffProgram(Worker->Machine, Worker->Stream, StreamSize);
+        diff_result Result = RunLockstep(Worker->Machine, Batch->Options);
+        Batch->Status[StreamIndex] = (u8)Result.Status;
+        Batch->DivergenceCounts[StreamIndex] = Result.DivergenceCount;
+    }
+}
+
+static b32 WriteStreamFile(char *FileName, u8 *Stream, u32 StreamSize)
+{
+    b32 Result = false;
+    
+    FILE *File = fopen(FileName, "wb");
+    if(File)
+    {
+        Result = (fwrite(Stream, 1, StreamSize, File) == StreamSize);
+        fclose(File);
+    }
+    
+    return Result;
+}
+
+static u32 RunRandomStreams(diff_options Options, u64 Seed, u32 StreamCount, u32 InstructionCount,
+                            u32 ThreadCount)
+{
+    u32 Result = 0;
+    
+    u32 MaxStreamSize = RANDOM_STREAM_PROLOGUE_SIZE + InstructionCount*RANDOM_INSTRUCTION_MAX_SIZE;
+    
+    random_batch Batch = {};
+    Batch.Options = Options;
+    Batch.Seed = Seed;
+    Batch.StreamCount = StreamCount;
+    Batch.InstructionCount = InstructionCount;
+    Batch.Status = (u8 *)calloc(StreamCount, 1);
+    Batch.DivergenceCounts = (u64 *)calloc(StreamCount, sizeof(u64));
+    
+    random_worker *Workers = (random_worker *)calloc(ThreadCount, sizeof(random_worker));
+    if(!Batch.Status || !Batch.DivergenceCounts || !Workers)
+    {
+        fprintf(stderr, "ERROR: Unable to allocate %u random streams.\n", StreamCount);
+        ThreadCount = 0;
+    }
+    
+    // NOTE(agent): The first worker runs on this thread, so it has to exist for anything to run. It is
+    // also what reruns the first failure afterwards.
+    u32 StartedCount = 0;
+    for(u32 WorkerIndex = 0; WorkerIndex < ThreadCount; ++WorkerIndex)
+    {
+        random_worker *Worker = Workers + WorkerIndex;
+        Worker->Batch = &Batch;
+        Worker->Machine = CreateDiffMachine();
+        Worker->Stream = (u8 *)malloc(MaxStreamSize);
+        if(Worker->Machine && Worker->Stream)
+        {
+            if((WorkerIndex == 0) || StartThread(&Worker->Thread, RandomWorkerProc, Worker))
+            {
+                ++StartedCount;
+            }
+        }
+        else if(WorkerIndex == 0)
+        {
+            fprintf(stderr, "ERROR: Unable to allocate a machine for random streams.\n");
+            break;
+        }
+    }
+    
+    if(StartedCount)
+    {
+        u64 StartTime = ReadOSTimer();
+        RandomWorkerProc(Workers);
+        for(u32 WorkerIndex = 1; WorkerIndex < ThreadCount; ++WorkerIndex)
+        {
+            if(Workers[WorkerIndex].Thread.Handle)
+            {
+                WaitForThread(&Workers[WorkerIndex].Thread);
+            }
+        }
+        u64 ElapsedTime = ReadOSTimer() - StartTime;
+        
+        u32 StatusCounts[Diff_Count] = {};
+        u64 DivergenceCount = 0;
+        u32 FirstFailure = StreamCount;
+        for(u32 StreamIndex = 0; StreamIndex < StreamCount; ++StreamIndex)
+        {
+            u8 Status = Batch.Status[StreamIndex];
+            ++StatusCounts[Status];
+            DivergenceCount += Batch.DivergenceCounts[StreamIndex];
+            if((Status != Diff_Match) && (FirstFailure == StreamCount))
+            {
+                FirstFailure = StreamIndex;
+            }
+        }
+        
+        fprintf(stdout, "%u random streams of %u instructions, seed 0x%llx, %u threads, %.3f seconds\n",
+                StreamCount, InstructionCount, Seed, StartedCount, (double)ElapsedTime / (double)GetOSTimerFreq());
+        for(u32 Status = 0; Status < Diff_Count; ++Status)
+        {
+            if(StatusCounts[Status])
+            {
+                fprintf(stdout, "%10u %s\n", StatusCounts[Status], DiffStatusNames[Status]);
+            }
+        }
+        if(Options.KeepGoing && DivergenceCount)
+        {
+            fprintf(stdout, "%10llu diverging instructions in all\n", DivergenceCount);
+        }
+        
+        // NOTE(agent): Streams are deterministic, so the first failure is simply generated and run
+        // again here to report it in full, regardless of which thread found it.
+        if(FirstFailure < StreamCount)
+        {
+            random_worker *Worker = Workers;
+            u64 FailSeed = StreamSeed(Seed, FirstFailure);
+            u32 StreamSize = GenerateRandomStream(FailSeed, InstructionCount, Worker->Stream);
+            LoadDiffProgram(Worker->Machine, Worker->Stream, StreamSize);
+            diff_result Failure = RunLockstep(Worker->Machine, Options);
+            
+            fprintf(stdout, "\nFirst failing stream: seed 0x%llx (replay with -seed 0x%llx -random 1)\n",
+                    FailSeed, FailSeed);
+            PrintDiffResult(&Failure, &Worker->Machine->Model, stdout);
+            
+            char FileName[64];
+            sprintf(FileName, "sim86_difftest_%llx.bin", FailSeed);
+            if(WriteStreamFile(FileName, Worker->Stream, StreamSize))
+            {
+                fprintf(stdout, "Stream written to %s\n", FileName);
+            }
+            else
+            {
+                fprintf(stderr, "ERROR: Unable to write %s.\n", FileName);
+            }
+        }
+        
+        Result = StreamCount - StatusCounts[Diff_Match];
+    }
+    
+    for(u32 WorkerIndex = 0; WorkerIndex < ThreadCount; ++WorkerIndex)
+    {
+        random_worker *Worker = Workers + WorkerIndex;
+        if(Worker->Machine)
+        {
+            free(Worker->Machine->Memory.Memory);
+            free(Worker->Machine);
+        }
+        free(Worker->Stream);
+    }
+    free(Workers);
+    free(Batch.Status);
+    free(Batch.DivergenceCounts);
+    
+    return Result;
+}
+
+static b32 RunFile(diff_machine *Machine, diff_options Options, char *FileName)
+{
+    b32 Result = false;
+    
+    os_mapped_file File;
+    if(MapFileForReading(&File, FileName))
+    {
+        LoadDiffProgram(Machine, File.Data, (u32)File.Size);
+        UnmapFile(&File);
+        
+        diff_result Diff = RunLockstep(Machine, Options);
+        fprintf(stdout, "%s: ", FileName);
+        PrintDiffResult(&Diff, &Machine->Model, stdout);
+        
+        Result = (Diff.Status == Diff_Match);
+    }
+    else
+    {
+        fprintf(stderr, "ERROR: Unable to open %s.\n", FileName);
+    }
+    
+    return Result;
+}
+
+// NOTE(agent): Turns flag letters like "OA" into the flags they name. Returns 0 if any letter is not
+// a compared flag.
+static b32 ParseFlagLetters(char *Letters, u16 *Flags)
+{
+    b32 Result = true;
+    
+    *Flags = 0;
+    for(char *At = Letters; Result && *At; ++At)
+    {
+        Result = false;
+        for(u32 Index = 0; Index < ArrayCount(ModelFlags); ++Index)
+        {
+            if((*At == ModelFlags[Index].Letter) || (*At == (ModelFlags[Index].Letter + ('a' - 'A'))))
+            {
+                *Flags |= ModelFlags[Index].Flag;
+                Result = true;
+            }
+        }
+    }
+    
+    return Result;
+}
+
+int main(int ArgCount, char **Args)
+{
+    int Result = 0;
+    
+    diff_options Options = {};
+    Options.MaxSteps = 1000000;
+    Options.FlagMask = COMPARED_FLAGS;
+    
+    u64 Seed = 1;
+    u32 RandomCount = 0;
+    u32 InstructionCount = 64;
+    u32 ThreadCount = GetLogicalProcessorCount();
+    u32 FileCount = 0;
+    
+    cg::init_register_map();
+    cg::init_decode_table();
+    
+    diff_machine *Machine = CreateDiffMachine();
+    if(Machine && (ArgCount > 1))
+    {
+        for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+        {
+            char *Arg = Args[ArgIndex];
+            b32 HasValue = ((ArgIndex + 1) < ArgCount);
+            
+            if(strcmp(Arg, "-noflags") == 0)
+            {
+                Options.FlagMask = 0;
+            }
+            else if(strcmp(Arg, "-keepgoing") == 0)
+            {
+                Options.KeepGoing = true;
+            }
+            else if((strcmp(Arg, "-ignoreflags") == 0) && HasValue)
+            {
+                u16 IgnoredFlags = 0;
+                char *Letters = Args[++ArgIndex];
+                if(ParseFlagLetters(Letters, &IgnoredFlags))
+                {
+                    Options.FlagMask &= ~IgnoredFlags;
+                }
+                else
+                {
+                    fprintf(stderr, "ERROR: -ignoreflags takes letters from CPAZSO, not %s.\n", Letters);
+                    Result = 2;
+                }
+            }
+            else if((strcmp(Arg, "-maxsteps") == 0) && HasValue)
+            {
+                Options.MaxSteps = strtoull(Args[++ArgIndex], 0, 0);
+            }
+            else if((strcmp(Arg, "-seed") == 0) && HasValue)
+            {
+                Seed = strtoull(Args[++ArgIndex], 0, 0);
+            }
+            else if((strcmp(Arg, "-random") == 0) && HasValue)
+            {
+                RandomCount = (u32)strtoul(Args[++ArgIndex], 0, 0);
+            }
+            else if((strcmp(Arg, "-length") == 0) && HasValue)
+            {
+                InstructionCount = (u32)strtoul(Args[++ArgIndex], 0, 0);
+            }
+            else if((strcmp(Arg, "-threads") == 0) && HasValue)
+            {
+                ThreadCount = (u32)strtoul(Args[++ArgIndex], 0, 0);
+            }
+            else if(Arg[0] == '-')
+            {
+                fprintf(stderr, "ERROR: Unrecognized option %s.\n", Arg);
+                Result = 2;
+            }
+            else
+            {
+                ++FileCount;
+                if(!RunFile(Machine, Options, Arg))
+                {
+                    Result = 1;
+                }
+            }
+        }
+        
+        if(RandomCount)
+        {
+            if(ThreadCount < 1)
+            {
+                ThreadCount = 1;
+            }
+            
+            if(RunRandomStreams(Options, Seed, RandomCount, InstructionCount, ThreadCount))
+            {
+                Result = 1;
+            }
+        }
+        else if(!FileCount)
+        {
+            fprintf(stderr, "ERROR: Nothing to compare - give files and/or -random.\n");
+            Result = 2;
+        }
+    }
+    else
+    {
+        fprintf(stderr, "USAGE: %s [options] [8086 machine code file] ...\n", Args[0]);
+        fprintf(stderr, "  -random [n]    also compare n random instruction streams\n");
+        fprintf(stderr, "  -length [n]    instructions per random stream (default 64)\n");
+        fprintf(stderr, "  -seed [n]      seed of the first random stream (default 1)\n");
+        fprintf(stderr, "  -threads [n]   threads for random streams (default: one per logical processor)\n");
+        fprintf(stderr, "  -maxsteps [n]  stop each program after n instructions (default 1000000)\n");
+        fprintf(stderr, "  -noflags       compare registers only\n");
+        fprintf(stderr, "  -ignoreflags [CPAZSO]  leave these flags out of the comparison\n");
+        fprintf(stderr, "  -keepgoing     count every diverging instruction, not just the first\n");
+        Result = 2;
+    }
+    
+    return Result;
+}
@@ -15,7 +15,7 @@ static segmented_access SegmentFromRegister(segmented_access Memory, u16 Registe
     assert(Memory.SegmentBase == 0);
     assert(Memory.SegmentOffset == 0);
     segmented_access Result = Memory;
-    Result.SegmentBase = RegisterContents;
+    SetSegmentBase(&Result, RegisterContents);
     return Result;
 }
 
@@ -56,7 +56,13 @@ static u16 GetRegisterValueU16(register_state_8086 *Registers, u32 Index)
 
 static void WriteU8(segmented_access Memory, u16 Offset, u8 Value)
 {
-    *AccessMemory(Memory, Offset) = Value;
+    u32 AbsAddr = GetAbsoluteAddressOf(Memory, Offset);
+    Memory.Memory[AbsAddr] = Value;
+    
+    if(Memory.Tracker)
+    {
+        NoteMemoryWrite(Memory.Tracker, AbsAddr);
+    }
 }
 
 static u8 ReadU8(segmented_access Memory, u16 Offset)
@@ -65,15 +71,52 @@ static u8 ReadU8(segmented_access Memory, u16 Offset)
     return Result;
 }
 
+// NOTE(agent): A word access can be done as a single 16-bit load or store unless its second byte
+// wraps around, either to the start of the segment or to the start of memory. Those cases go byte
+// by byte so that the wrap happens exactly as it would on the 8086. This relies on the host being
+// little-endian, like the register union does.
+static b32 WordAccessWraps(segmented_access Memory, u16 Offset, u32 AbsAddr)
+{
+    b32 Result = (((u16)(Memory.SegmentOffset + Offset) == 0xffff) ||
+                  (AbsAddr == Memory.Mask));
+    return Result;
+}
+
 static void WriteU16(segmented_access Memory, u16 Offset, u16 Value)
 {
-    WriteU8(Memory, Offset + 0, (Value & 0xff));
-    WriteU8(Memory, Offset + 1, ((Value >> 8) & 0xff));
+    u32 AbsAddr = GetAbsoluteAddressOf(Memory, Offset);
+    if(WordAccessWraps(Memory, Offset, AbsAddr))
+    {
+        WriteU8(Memory, Offset + 0, (Value & 0xff));
+        WriteU8(Memory, Offset + 1, ((Value >> 8) & 0xff));
+    }
+    else
+    {
+        // NOTE(agent): memcpy because odd addresses are common, and this still compiles to one store.
+        memcpy(Memory.Memory + AbsAddr, &Value, sizeof(Value));
+        
+        if(Memory.Tracker)
+        {
+            NoteMemoryWrite(Memory.Tracker, AbsAddr);
+            NoteMemoryWrite(Memory.Tracker, AbsAddr + 1);
+        }
+    }
 }
 
 static u16 ReadU16(segmented_access Memory, u16 Offset)
 {
-    u16 Result = (u16)ReadU8(Memory, Offset) | ((u16)ReadU8(Memory, Offset + 1) << 8);
+    u16 Result;
+    
+    u32 AbsAddr = GetAbsoluteAddressOf(Memory, Offset);
+    if(WordAccessWraps(Memory, Offset, AbsAddr))
+    {
+        Result = (u16)ReadU8(Memory, Offset) | ((u16)ReadU8(Memory, Offset + 1) << 8);
+    }
+    else
+    {
+        memcpy(&Result, Memory.Memory + AbsAddr, sizeof(Result));
+    }
+    
     return Result;
 }
 
@@ -118,19 +161,20 @@ static void PopFlags(segmented_access Memory, register_state_8086 *Registers)
     Registers->flags |= Pop(Memory, Registers);
 }
 
-static u16 SignBitFor(u32 WWidth)
+static constexpr u16 SignBitFor(u32 WWidth)
 {
     u16 Result = (WWidth == 1) ? (1 << 7) : (1 << 15);
     return Result;
 }
 
-static u16 WidthMaskFor(u32 WWidth)
+static constexpr u16 WidthMaskFor(u32 WWidth)
 {
     u16 Result = (WWidth == 1) ? 0xff : 0xffff;
     return Result;
 }
 
-static u16 ParityFlagOf(u16 x)
+static_assert(Flag_PF == (1 << 2), "ParityFlagOf assumes PF is bit 2");
+static constexpr u16 ParityFlagOf(u16 x)
 {
     // NOTE(casey): Normally you would use a population count instruction for this operation,
     // but the only way to do that in vanilla C++ is to use the std:: library which I don't
@@ -147,35 +191,113 @@ static u16 ParityFlagOf(u16 x)
     // Apparently it was only for backwards compatibility, so it
     // never looks at the high 8 bits.
     
-    assert(Flag_PF == (1 << 2));
     return ((~y & 0x1) << 2);
 }
 
-static void UpdateCommonFlags(register_state_8086 *Registers, u32 MaskedResult, u32 WWidth)
+/* NOTE(agent): SF, ZF and PF for every possible 8-bit result, built at compile time. Since PF
+   never looks at the high 8 bits, the same table also gives PF for 16-bit results, so the flags
+   every arithmetic and logical instruction sets come down to one load (plus two compares for
+   words) instead of the parity fold.
+   
+   The original version, which computes them directly, is kept in sim86_bench.cpp as the reference
+   the table is checked against (see sim86_bench -alu).
+*/
+struct common_flags_table
 {
-    Registers->flags &= ~(Flag_SF | Flag_ZF | Flag_PF);
-    Registers->flags |= (MaskedResult & SignBitFor(WWidth)) ? Flag_SF : 0;
-    Registers->flags |= (MaskedResult == 0) ? Flag_ZF : 0;
-    Registers->flags |= ParityFlagOf(MaskedResult);
+    u8 Flags[256];
+};
+
+static constexpr common_flags_table BuildCommonFlagsTable(void)
+{
+    common_flags_table Result = {};
+    for(u32 Value = 0; Value < ArrayCount(Result.Flags); ++Value)
+    {
+        u32 Flags = ParityFlagOf((u16)Value);
+        Flags |= (Value & 0x80) ? Flag_SF : 0;
+        Flags |= (Value == 0) ? Flag_ZF : 0;
+        Result.Flags[Value] = (u8)Flags;
+    }
+    
+    return Result;
 }
 
-static void UpdateArithFlags(register_state_8086 *Registers, u32 UnmaskedResult, u32 MaskedResult, u32 WWidth, b32 OF = false, b32 AF = false)
+static constexpr common_flags_table CommonFlagsTable = BuildCommonFlagsTable();
+static_assert(CommonFlagsTable.Flags[0x00] == (Flag_ZF | Flag_PF), "Common flags table was built incorrectly");
+static_assert(CommonFlagsTable.Flags[0x01] == 0, "Common flags table was built incorrectly");
+static_assert(CommonFlagsTable.Flags[0x81] == (Flag_SF | Flag_PF), "Common flags table was built incorrectly");
+
+// NOTE(agent): The ...For<WWidth> versions are for when the width is known at compile time, so the
+// width tests and masks all fold away. The plain versions pick one of them at run time.
+template<u32 WWidth>
+static u32 CommonFlagsFor(u32 MaskedResult)
 {
-    u32 SignBit = SignBitFor(WWidth);
-    b32 CF = (UnmaskedResult & (SignBit << 1));
+    u32 Result = CommonFlagsTable.Flags[MaskedResult & 0xff];
+    if(WWidth == 1)
+    {
+        // NOTE(agent): test passes its result through without masking it, so a byte result can
+        // still have high bits set, and then it is not zero.
+        Result &= (MaskedResult >> 8) ? ~(u32)Flag_ZF : ~(u32)0;
+    }
+    else
+    {
+        Result &= Flag_PF;
+        Result |= (MaskedResult & 0x8000) ? Flag_SF : 0;
+        Result |= (MaskedResult == 0) ? Flag_ZF : 0;
+    }
     
-    Registers->flags &= ~(Flag_OF | Flag_CF | Flag_AF);
-    Registers->flags |= CF ? Flag_CF : 0;
-    Registers->flags |= OF ? Flag_OF : 0;
-    Registers->flags |= AF ? Flag_AF : 0;
+    return Result;
+}
 
-    UpdateCommonFlags(Registers, MaskedResult, WWidth);
+template<u32 WWidth>
+static void UpdateCommonFlagsFor(register_state_8086 *Registers, u32 MaskedResult)
+{
+    u32 Flags = Registers->flags & ~(Flag_SF | Flag_ZF | Flag_PF);
+    Registers->flags = (u16)(Flags | CommonFlagsFor<WWidth>(MaskedResult));
+}
+
+template<u32 WWidth>
+static void UpdateArithFlagsFor(register_state_8086 *Registers, u32 UnmaskedResult, u32 MaskedResult, b32 OF = false, b32 AF = false)
+{
+    u32 Flags = Registers->flags & ~(Flag_OF | Flag_CF | Flag_AF | Flag_SF | Flag_ZF | Flag_PF);
+    Flags |= (UnmaskedResult & (SignBitFor(WWidth) << 1)) ? Flag_CF : 0;
+    Flags |= OF ? Flag_OF : 0;
+    Flags |= AF ? Flag_AF : 0;
+    Flags |= CommonFlagsFor<WWidth>(MaskedResult);
+    
+    Registers->flags = (u16)Flags;
+}
+
+template<u32 WWidth>
+static void UpdateLogFlagsFor(register_state_8086 *Registers, u16 MaskedResult)
+{
+    u32 Flags = Registers->flags & ~(Flag_OF | Flag_CF | Flag_AF | Flag_SF | Flag_ZF | Flag_PF);
+    Flags |= CommonFlagsFor<WWidth>(MaskedResult);
+    
+    Registers->flags = (u16)Flags;
+}
+
+static void UpdateArithFlags(register_state_8086 *Registers, u32 UnmaskedResult, u32 MaskedResult, u32 WWidth, b32 OF = false, b32 AF = false)
+{
+    if(WWidth == 1)
+    {
+        UpdateArithFlagsFor<1>(Registers, UnmaskedResult, MaskedResult, OF, AF);
+    }
+    else
+    {
+        UpdateArithFlagsFor<2>(Registers, UnmaskedResult, MaskedResult, OF, AF);
+    }
 }
 
 static void UpdateLogFlags(register_state_8086 *Registers, u16 MaskedResult, u32 WWidth)
 {
-    Registers->flags &= ~(Flag_OF | Flag_CF | Flag_AF);
-    UpdateCommonFlags(Registers, MaskedResult, WWidth);
+    if(WWidth == 1)
+    {
+        UpdateLogFlagsFor<1>(Registers, MaskedResult);
+    }
+    else
+    {
+        UpdateLogFlagsFor<2>(Registers, MaskedResult);
+    }
 }
 
 static void WriteLogOpResult(register_state_8086 *Registers, segmented_access Dest, u16 UnmaskedResult, u32 WWidth)
@@ -236,6 +358,41 @@ static void ConditionalJump(exec_result *Result, register_state_8086 *Registers,
     Result->BranchTaken = ShouldJump;
 }
 
+static b32 JumpConditionHolds(operation_type Op, u16 Flags)
+{
+    b32 Result = false;
+    
+    b32 CF = Flags & Flag_CF;
+    b32 PF = Flags & Flag_PF;
+    b32 ZF = Flags & Flag_ZF;
+    b32 SF = Flags & Flag_SF;
+    b32 OF = Flags & Flag_OF;
+    
+    switch(Op)
+    {
+        case Op_je:  {Result = (ZF == 1);} break;
+        case Op_jl:  {Result = ((SF ^ OF) == 1);} break;
+        case Op_jle: {Result = (((SF ^ OF) | ZF) == 1);} break;
+        case Op_jb:  {Result = (CF == 1);} break;
+        case Op_jbe: {Result = ((CF | ZF) == 1);} break;
+        case Op_jp:  {Result = (PF == 1);} break;
+        case Op_jo:  {Result = (OF == 1);} break;
+        case Op_js:  {Result = (SF == 1);} break;
+        case Op_jne: {Result = (ZF == 0);} break;
+        case Op_jnl: {Result = ((SF ^ OF) == 0);} break;
+        case Op_jg:  {Result = (((SF & OF) | ZF) == 0);} break;
+        case Op_jnb: {Result = (CF == 0);} break;
+        case Op_ja:  {Result = ((CF | ZF) == 0);} break;
+        case Op_jnp: {Result = (PF == 0);} break;
+        case Op_jno: {Result = (OF == 0);} break;
+        case Op_jns: {Result = (SF == 0);} break;
+        
+        default: {} break;
+    }
+    
+    return Result;
+}
+
 static segmented_access DetermineSegmentAccess(segmented_access Memory, instruction Instruction, register_state_8086 *Registers,
                                                u16 DefaultSegRegValue)
 {
@@ -277,14 +434,15 @@ static operand_access AccessOperand(segmented_access Memory, register_state_8086
             
             if(Source.Address.Flags & Address_ExplicitSegment)
             {
-                Result.Op.SegmentBase = Source.Address.ExplicitSegment;
+                SetSegmentBase(&Result.Op, Source.Address.ExplicitSegment);
             }
             else
             {
                 u16 SegReg = (Source.Address.Terms[0].Register.Index == Register_bp) ? Registers->ss : Registers->ds;
                 
                 Result.Op.Memory = Memory.Memory;
-                Result.Op.SegmentBase = DetermineSegmentAccess(Memory, Instruction, Registers, SegReg).SegmentBase;
+                Result.Op.Tracker = Memory.Tracker;
+                SetSegmentBase(&Result.Op, DetermineSegmentAccess(Memory, Instruction, Registers, SegReg).SegmentBase);
                 for(u32 TermIndex = 0; TermIndex < ArrayCount(Source.Address.Terms); ++TermIndex)
                 {
                     effective_address_term Term = Source.Address.Terms[TermIndex];
@@ -312,12 +470,8 @@ static exec_result ExecInstruction(segmented_access Memory, register_state_8086
     u32 WWidth = (Instruction.Flags & Inst_Wide) ? 2 : 1;
     b32 IsFar = (Instruction.Flags & Inst_Far);
     
-    b32 CF = Registers->flags & Flag_CF;
-    b32 PF = Registers->flags & Flag_PF;
     b32 AF = Registers->flags & Flag_AF;
     b32 ZF = Registers->flags & Flag_ZF;
-    b32 SF = Registers->flags & Flag_SF;
-    b32 OF = Registers->flags & Flag_OF;
     b32 IF = Registers->flags & Flag_IF;
     b32 DF = Registers->flags & Flag_DF;
     b32 TF = Registers->flags & Flag_TF;
@@ -662,83 +816,23 @@ static exec_result ExecInstruction(segmented_access Memory, register_state_8086
         } break;
         
         case Op_je:
-        {
-            ConditionalJump(&Result, Registers, V0, ZF == 1);
-        } break;
-        
         case Op_jl:
-        {
-            ConditionalJump(&Result, Registers, V0, (SF ^ OF) == 1);
-        } break;
-        
         case Op_jle:
-        {
-            ConditionalJump(&Result, Registers, V0, ((SF ^ OF) | ZF) == 1);
-        } break;
-        
         case Op_jb:
-        {
-            ConditionalJump(&Result, Registers, V0, CF == 1);
-        } break;
-        
         case Op_jbe:
-        {
-            ConditionalJump(&Result, Registers, V0, (CF | ZF) == 1);
-        } break;
-        
         case Op_jp:
-        {
-            ConditionalJump(&Result, Registers, V0, PF == 1);
-        } break;
-        
         case Op_jo:
-        {
-            ConditionalJump(&Result, Registers, V0, OF == 1);
-        } break;
-        
         case Op_js:
-        {
-            ConditionalJump(&Result, Registers, V0, SF == 1);
-        } break;
-        
         case Op_jne:
-        {
-            ConditionalJump(&Result, Registers, V0, ZF == 0);
-        } break;
-        
         case Op_jnl:
-        {
-            ConditionalJump(&Result, Registers, V0, (SF ^ OF) == 0);
-        } break;
-        
         case Op_jg:
-        {
-            ConditionalJump(&Result, Registers, V0, ((SF & OF) | ZF) == 0);
-        } break;
-        
         case Op_jnb:
-        {
-            ConditionalJump(&Result, Registers, V0, CF == 0);
-        } break;
-        
         case Op_ja:
-        {
-            ConditionalJump(&Result, Registers, V0, (CF | ZF) == 0);
-        } break;
-        
         case Op_jnp:
-        {
-            ConditionalJump(&Result, Registers, V0, PF == 0);
-        } break;
-        
         case Op_jno:
-        {
-            ConditionalJump(&Result, Registers, V0, OF == 0);
-        } break;
-        
         case Op_jns:
         {
-            ConditionalJump(&Result, Registers, V0, SF == 0);
+            ConditionalJump(&Result, Registers, V0, JumpConditionHolds(Instruction.Op, Registers->flags));
         } break;
         
         case Op_loop:
@@ -14,17 +14,42 @@
 
 #include "sim86.h"
 
+// NOTE(agent): Only for the two-byte memcpys in ReadU16/WriteU16, which compilers expand into a
+// single load or store rather than a call into the C runtime.
+#include <string.h>
+
 #include "sim86_instruction.h"
 #include "sim86_instruction_table.h"
 #include "sim86_memory.h"
 #include "sim86_decode.h"
+#include "sim86_execute.h"
+#include "sim86_cycles.h"
+#include "sim86_machine.h"
 
 #include "sim86_instruction.cpp"
 #include "sim86_instruction_table.cpp"
 #include "sim86_memory.cpp"
 #include "sim86_decode.cpp"
+#include "sim86_decode_compiled.cpp"
+#include "sim86_execute.cpp"
+#include "sim86_cycles.cpp"
 #include "sim86_text_table.cpp"
 
+#define SIM86_MACHINE_MEMORY_POW2 20
+
+struct sim86_machine
+{
+    segmented_access Memory;
+    register_state_8086 Registers;
+    timing_state Timing;
+    instruction_clock_interval Clocks;
+    u64 InstructionCount;
+    u32 OnePastLastByte;
+    u32 Flags;
+    
+    u8 MemoryBytes[1 << SIM86_MACHINE_MEMORY_POW2];
+};
+
 extern "C" u32 Sim86_GetVersion(void)
 {
     u32 Result = SIM86_VERSION;
@@ -55,6 +80,54 @@ extern "C" void Sim86_Decode8086Instruction(u32 SourceSize, u8 *Source, instruct
     *Dest = DecodeInstruction(Table, At);
 }
 
+extern "C" void Sim86_Decode8086Stream(u32 SourceSize, u8 *Source, instruction *Dest, u32 MaxCount, u32 *OutCount)
+{
+    // NOTE(agent): This decodes as many instructions as it can from Source in one call, so that
+    // bindings for other languages do not have to pay the cost of calling across into the library
+    // once per instruction. Decoding stops at the end of Source, after MaxCount instructions, at
+    // the first unrecognized instruction, or at an instruction that would extend past the end of
+    // Source. Unlike Sim86_Decode8086Instruction, each instruction's Address is its byte offset
+    // from the start of Source.
+    instruction_table Table = Get8086InstructionTable();
+    decode_dispatch const *Dispatch = GetDecodeDispatch(Table);
+    
+    assert(Table.MaxInstructionByteCount == 15);
+    
+    u32 Count = 0;
+    u32 Offset = 0;
+    while((Count < MaxCount) && (Offset < SourceSize))
+    {
+        u8 *At = Source + Offset;
+        u32 Remaining = SourceSize - Offset;
+        
+        u8 GuardBuffer[16] = {};
+        if(Remaining < Table.MaxInstructionByteCount)
+        {
+            for(u32 I = 0; I < Remaining; ++I)
+            {
+                GuardBuffer[I] = At[I];
+            }
+            
+            At = GuardBuffer;
+        }
+        
+        instruction Instruction = DecodeInstructionWith(Table, Dispatch, GetCompiledDecoders(Table), FixedMemoryPow2(4, At));
+        if(!Instruction.Op || (Instruction.Size > Remaining))
+        {
+            break;
+        }
+        
+        Instruction.Address = Offset;
+        Dest[Count++] = Instruction;
+        Offset += Instruction.Size;
+    }
+    
+    if(OutCount)
+    {
+        *OutCount = Count;
+    }
+}
+
 extern "C" char const *Sim86_RegisterNameFromOperand(register_access *RegAccess)
 {
     char const *Result = GetRegName(*RegAccess);
@@ -70,4 +143,208 @@ extern "C" char const *Sim86_MnemonicFromOperationType(operation_type Type)
 extern "C" void Sim86_Get8086InstructionTable(instruction_table *Dest)
 {
     *Dest = Get8086InstructionTable();
-}
\ No newline at end of file
+}
+
+extern "C" u32 Sim86_GetMachineSize(void)
+{
+    u32 Result = sizeof(sim86_machine);
+    return Result;
+}
+
+static void ResetMachine(sim86_machine *Machine)
+{
+    // NOTE(agent): Manual loops rather than memset, for the same reason as in Sim86_Decode8086Instruction.
+    for(u32 I = 0; I < ArrayCount(Machine->MemoryBytes); ++I)
+    {
+        Machine->MemoryBytes[I] = 0;
+    }
+    
+    for(u32 I = 0; I < ArrayCount(Machine->Registers.u16); ++I)
+    {
+        Machine->Registers.u16[I] = 0;
+    }
+    
+    Machine->Clocks = {};
+    Machine->InstructionCount = 0;
+    Machine->OnePastLastByte = 0;
+}
+
+extern "C" sim86_machine *Sim86_CreateMachine(u32 MemorySize, void *Memory, u32 MachineFlags)
+{
+    // NOTE(agent): The library never allocates. The caller provides MemorySize bytes at Memory
+    // (at least Sim86_GetMachineSize() of them, 8-byte aligned), and owns them - there is no
+    // "destroy" call, the caller just frees the memory when it is done with the machine.
+    sim86_machine *Result = 0;
+    
+    if(Memory && (MemorySize >= sizeof(sim86_machine)) && !((u64)Memory & 7))
+    {
+        Result = (sim86_machine *)Memory;
+        
+        Result->Memory = FixedMemoryPow2(SIM86_MACHINE_MEMORY_POW2, Result->MemoryBytes);
+        Result->Flags = MachineFlags;
+        Result->Timing = {};
+        Result->Timing.Assume8088 = (MachineFlags & Sim86Machine_Assume8088);
+        ResetMachine(Result);
+    }
+    
+    return Result;
+}
+
+extern "C" void Sim86_LoadProgram(sim86_machine *Machine, u32 SourceSize, u8 *Source)
+{
+    // NOTE(agent): Loading a program resets the whole machine (memory, registers, clocks), then places
+    // the program at address 0, which is where execution starts, just like the sim86 command line.
+    ResetMachine(Machine);
+    
+    if(SourceSize > ArrayCount(Machine->MemoryBytes))
+    {
+        SourceSize = ArrayCount(Machine->MemoryBytes);
+    }
+    
+    for(u32 I = 0; I < SourceSize; ++I)
+    {
+        Machine->MemoryBytes[I] = Source[I];
+    }
+    
+    Machine->OnePastLastByte = SourceSize;
+}
+
+extern "C" sim86_status Sim86_Step(sim86_machine *Machine, instruction *Executed)
+{
+    // NOTE(agent): This follows Run8086 in sim86.cpp exactly, so that a binding stepping through a
+    // program sees the same results the command line would print.
+    sim86_status Result = Sim86Status_Running;
+    
+    instruction_table Table = Get8086InstructionTable();
+    register_state_8086 *Registers = &Machine->Registers;
+    
+    segmented_access At = Machine->Memory;
+    At.Mask = 0xffff;
+    SetSegmentBase(&At, Registers->cs);
+    At.SegmentOffset = Registers->ip;
+    
+    instruction Instruction = {};
+    if(GetAbsoluteAddressOf(At) < Machine->OnePastLastByte)
+    {
+        Instruction = DecodeInstruction(Table, At);
+        if(!Instruction.Op)
+        {
+            Result = Sim86Status_UnrecognizedInstruction;
+        }
+        else if((Machine->Flags & Sim86Machine_StopOnRet) &&
+                ((Instruction.Op == Op_ret) || (Instruction.Op == Op_retf)))
+        {
+            Result = Sim86Status_StopOnRet;
+        }
+        else
+        {
+            Registers->ip += Instruction.Size;
+            exec_result Exec = ExecInstruction(Machine->Memory, Registers, Instruction);
+            if(Exec.Unimplemented)
+            {
+                Result = Sim86Status_UnimplementedInstruction;
+            }
+            else
+            {
+                ++Machine->InstructionCount;
+                
+                UpdateTimingForExec(&Machine->Timing, Exec);
+                instruction_timing Timing = EstimateInstructionClocks(Machine->Timing, Instruction);
+                instruction_clock_interval Clocks = ExpectedClocksFrom(Machine->Timing, Instruction, Timing);
+                Machine->Clocks.Min += Clocks.Min;
+                Machine->Clocks.Max += Clocks.Max;
+            }
+        }
+    }
+    else
+    {
+        Result = Sim86Status_OutsideProgram;
+    }
+    
+    if(Executed)
+    {
+        *Executed = Instruction;
+    }
+    
+    return Result;
+}
+
+extern "C" sim86_status Sim86_Run(sim86_machine *Machine, u32 MaxInstructionCount)
+{
+    sim86_status Result = Sim86Status_Running;
+    
+    for(u32 Count = 0; (Count < MaxInstructionCount) && (Result == Sim86Status_Running); ++Count)
+    {
+        Result = Sim86_Step(Machine, 0);
+    }
+    
+    return Result;
+}
+
+extern "C" u64 Sim86_GetInstructionCount(sim86_machine *Machine)
+{
+    u64 Result = Machine->InstructionCount;
+    return Result;
+}
+
+extern "C" u32 Sim86_GetRegister(sim86_machine *Machine, register_index Index)
+{
+    u32 Result = 0;
+    if(Index < ArrayCount(Machine->Registers.u16))
+    {
+        Result = Machine->Registers.u16[Index];
+    }
+    
+    return Result;
+}
+
+extern "C" void Sim86_SetRegister(sim86_machine *Machine, register_index Index, u32 Value)
+{
+    // NOTE(agent): Register 0 is the "no register" slot, which always has to read as zero.
+    if((Index > 0) && (Index < ArrayCount(Machine->Registers.u16)))
+    {
+        Machine->Registers.u16[Index] = (u16)Value;
+    }
+}
+
+extern "C" u32 Sim86_ReadMemory(sim86_machine *Machine, u32 Address, u32 Count, u8 *Dest)
+{
+    u32 Result = 0;
+    for(; (Result < Count) && ((Address + Result) < ArrayCount(Machine->MemoryBytes)); ++Result)
+    {
+        Dest[Result] = Machine->MemoryBytes[Address + Result];
+    }
+    
+    return Result;
+}
+
+extern "C" u32 Sim86_WriteMemory(sim86_machine *Machine, u32 Address, u32 Count, u8 *Source)
+{
+    u32 Result = 0;
+    for(; (Result < Count) && ((Address + Result) < ArrayCount(Machine->MemoryBytes)); ++Result)
+    {
+        Machine->MemoryBytes[Address + Result] = Source[Result];
+    }
+    
+    return Result;
+}
+
+extern "C" void Sim86_GetClocks(sim86_machine *Machine, u32 *MinClocks, u32 *MaxClocks)
+{
+    *MinClocks = Machine->Clocks.Min;
+    *MaxClocks = Machine->Clocks.Max;
+}
+
+extern "C" void Sim86_EstimateInstructionClocks(instruction *Instruction, u32 MachineFlags, u32 *MinClocks, u32 *MaxClocks)
+{
+    // NOTE(agent): Without a machine there is no execution to look at, so this makes the same
+    // assumptions as disassembly with -showclocks does (branches taken, etc.)
+    timing_state State = {};
+    State.Assume8088 = (MachineFlags & Sim86Machine_Assume8088);
+    State.AssumeBranchTaken = true;
+    
+    instruction_timing Timing = EstimateInstructionClocks(State, *Instruction);
+    instruction_clock_interval Clocks = ExpectedClocksFrom(State, *Instruction, Timing);
+    *MinClocks = Clocks.Min;
+    *MaxClocks = Clocks.Max;
+}
@@ -0,0 +1,25 @@
+/* ========================================================================
+
+   sim86_machine.h - Machine types for the execution entry points of the shared library
+
+   ======================================================================== */
+
+// NOTE(agent): These are the types used by the execution entry points of the shared library.
+// The machine itself is opaque to callers - they provide the memory for it (see
+// Sim86_GetMachineSize), and the library never allocates anything on its own.
+typedef struct sim86_machine sim86_machine;
+
+typedef enum sim86_machine_flag : u32
+{
+    Sim86Machine_StopOnRet = 0x1, // NOTE(agent): Stop (without executing) when a ret/retf is reached, like -stoponret
+    Sim86Machine_Assume8088 = 0x2, // NOTE(agent): Estimate clocks for an 8088 instead of an 8086, like -8088
+} sim86_machine_flag;
+
+typedef enum sim86_status : u32
+{
+    Sim86Status_Running, // NOTE(agent): The instruction executed (or the instruction limit was reached), and execution can continue
+    Sim86Status_OutsideProgram, // NOTE(agent): cs:ip is past the end of the loaded program, which is how a program normally ends
+    Sim86Status_StopOnRet,
+    Sim86Status_UnrecognizedInstruction,
+    Sim86Status_UnimplementedInstruction,
+} sim86_status;
@@ -0,0 +1,133 @@
+/* ========================================================================
+
+   sim86_memdiff.cpp - Compares the memory of two runs, page by page
+
+   ======================================================================== */
+
+/* NOTE(agent): sim86_memdiff compares the memory of two runs, page by page. Either file can be a page
+   dump from "sim86 -dumppages" or a raw dump from "sim86 -dump". A page that only one of two page
+   dumps contains was only written by that run, so it is reported as such rather than compared.
+   When one side is a raw dump, only the pages the other side contains are compared.
+*/
+
+#include "sim86.h"
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "sim86_memory.h"
+#include "sim86_memdump.h"
+#include "sim86_memdump_read.h"
+
+#include "sim86_memory.cpp"
+#include "sim86_memdump.cpp"
+#include "sim86_memdump_read.cpp"
+
+static loaded_memory_dump *LoadMemoryDumpFile(char *FileName)
+{
+    loaded_memory_dump *Result = (loaded_memory_dump *)malloc(sizeof(loaded_memory_dump));
+    if(Result)
+    {
+        FILE *File = fopen(FileName, "rb");
+        if(File)
+        {
+            if(!LoadMemoryDump(File, Result))
+            {
+                fprintf(stderr, "ERROR: %s is truncated or corrupt.\n", FileName);
+                free(Result);
+                Result = 0;
+            }
+            
+            fclose(File);
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Unable to open %s.\n", FileName);
+            free(Result);
+            Result = 0;
+        }
+    }
+    
+    return Result;
+}
+
+static u32 DiffMemoryDumps(loaded_memory_dump *A, char *NameA, loaded_memory_dump *B, char *NameB, FILE *Dest)
+{
+    u32 Result = 0;
+    
+    u32 PageSize = 1 << MEMORY_TRACKER_PAGE_SIZE_POW2;
+    u32 ComparedCount = 0;
+    for(u32 PageIndex = 0; PageIndex < MEMORY_TRACKER_PAGE_COUNT; ++PageIndex)
+    {
+        u32 PageAddress = PageIndex << MEMORY_TRACKER_PAGE_SIZE_POW2;
+        b32 InA = A->PagePresent[PageIndex];
+        b32 InB = B->PagePresent[PageIndex];
+        if(InA && InB)
+        {
+            ++ComparedCount;
+            
+            b32 PageDiffers = false;
+            u32 Offset = 0;
+            while(Offset < PageSize)
+            {
+                u32 Address = PageAddress + Offset;
+                if(A->Memory[Address] != B->Memory[Address])
+                {
+                    u32 First = Address;
+                    while((Offset < PageSize) && (A->Memory[PageAddress + Offset] != B->Memory[PageAddress + Offset]))
+                    {
+                        ++Offset;
+                    }
+                    
+                    fprintf(Dest, "0x%05x-0x%05x: differs\n", First, PageAddress + Offset - 1);
+                    PageDiffers = true;
+                }
+                else
+                {
+                    ++Offset;
+                }
+            }
+            
+            Result += PageDiffers;
+        }
+        else if((InA || InB) && A->IsPageDump && B->IsPageDump)
+        {
+            ++ComparedCount;
+            ++Result;
+            fprintf(Dest, "0x%05x-0x%05x: only written in %s\n", PageAddress, PageAddress + PageSize - 1,
+                    InA ? NameA : NameB);
+        }
+    }
+    
+    fprintf(Dest, "%u of %u pages differ\n", Result, ComparedCount);
+    
+    return Result;
+}
+
+int main(int ArgCount, char **Args)
+{
+    int Result = 2;
+    
+    if(ArgCount == 3)
+    {
+        loaded_memory_dump *A = LoadMemoryDumpFile(Args[1]);
+        loaded_memory_dump *B = LoadMemoryDumpFile(Args[2]);
+        if(A && B)
+        {
+            Result = DiffMemoryDumps(A, Args[1], B, Args[2], stdout) ? 1 : 0;
+        }
+        
+        free(A);
+        free(B);
+    }
+    else
+    {
+        fprintf(stderr, "USAGE: %s [memory dump] [memory dump]\n", Args[0]);
+    }
+    
+    return Result;
+}
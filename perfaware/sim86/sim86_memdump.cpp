@@ -0,0 +1,37 @@
+/* ========================================================================
+
+   sim86_memdump.cpp - Dirty page dumps (-dumppages)
+
+   ======================================================================== */
+
+static b32 WriteDirtyPages(FILE *File, memory_tracker *Tracker, segmented_access Memory)
+{
+    u32 PageSize = 1 << MEMORY_TRACKER_PAGE_SIZE_POW2;
+    u32 PageCount = (GetHighestAddress(Memory) + 1) >> MEMORY_TRACKER_PAGE_SIZE_POW2;
+    if(PageCount > MEMORY_TRACKER_PAGE_COUNT)
+    {
+        PageCount = MEMORY_TRACKER_PAGE_COUNT;
+    }
+    
+    page_dump_header Header = {};
+    Header.Magic = SIM86_PAGE_DUMP_MAGIC;
+    Header.Version = SIM86_PAGE_DUMP_VERSION;
+    Header.PageSize = PageSize;
+    for(u32 PageIndex = 0; PageIndex < PageCount; ++PageIndex)
+    {
+        Header.PageCount += Tracker->DirtyPages[PageIndex];
+    }
+    
+    b32 Result = (fwrite(&Header, sizeof(Header), 1, File) == 1);
+    for(u32 PageIndex = 0; Result && (PageIndex < PageCount); ++PageIndex)
+    {
+        if(Tracker->DirtyPages[PageIndex])
+        {
+            u32 Address = PageIndex << MEMORY_TRACKER_PAGE_SIZE_POW2;
+            Result = ((fwrite(&Address, sizeof(Address), 1, File) == 1) &&
+                      (fwrite(Memory.Memory + Address, PageSize, 1, File) == 1));
+        }
+    }
+    
+    return Result;
+}
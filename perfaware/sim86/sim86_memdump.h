@@ -0,0 +1,27 @@
+/* ========================================================================
+
+   sim86_memdump.h - Dirty page dumps (-dumppages)
+
+   ======================================================================== */
+
+/* NOTE(agent): A page dump holds only the memory pages a run wrote to, rather than all of memory
+   like -dump does. Values are little-endian. The layout is:
+
+     u32 Magic ('S86D'), u32 Version, u32 PageSize, u32 PageCount
+     PageCount times: u32 Address, u8 Bytes[PageSize]
+
+   Pages are in increasing address order.
+*/
+
+#define SIM86_PAGE_DUMP_MAGIC 0x44363853 // NOTE(agent): 'S86D'
+#define SIM86_PAGE_DUMP_VERSION 1
+
+struct page_dump_header
+{
+    u32 Magic;
+    u32 Version;
+    u32 PageSize;
+    u32 PageCount;
+};
+
+static b32 WriteDirtyPages(FILE *File, memory_tracker *Tracker, segmented_access Memory);
@@ -0,0 +1,53 @@
+/* ========================================================================
+
+   sim86_memdump_read.cpp - Loading page dumps and raw memory dumps back in
+
+   ======================================================================== */
+
+static b32 LoadMemoryDump(FILE *File, loaded_memory_dump *Dump)
+{
+    memset(Dump, 0, sizeof(*Dump));
+    
+    b32 Result = false;
+    
+    u32 PageSize = 1 << MEMORY_TRACKER_PAGE_SIZE_POW2;
+    page_dump_header Header = {};
+    if((fread(&Header, sizeof(Header), 1, File) == 1) &&
+       (Header.Magic == SIM86_PAGE_DUMP_MAGIC))
+    {
+        Dump->IsPageDump = true;
+        if((Header.Version == SIM86_PAGE_DUMP_VERSION) &&
+           (Header.PageSize == PageSize) &&
+           (Header.PageCount <= MEMORY_TRACKER_PAGE_COUNT))
+        {
+            Result = true;
+            for(u32 Index = 0; Result && (Index < Header.PageCount); ++Index)
+            {
+                u32 Address;
+                Result = ((fread(&Address, sizeof(Address), 1, File) == 1) &&
+                          (Address < sizeof(Dump->Memory)) &&
+                          ((Address & (PageSize - 1)) == 0) &&
+                          (fread(Dump->Memory + Address, PageSize, 1, File) == 1));
+                if(Result)
+                {
+                    Dump->PagePresent[Address >> MEMORY_TRACKER_PAGE_SIZE_POW2] = 1;
+                }
+            }
+        }
+    }
+    else
+    {
+        // NOTE(agent): Anything without the page dump header is taken to be a raw -dump of memory.
+        fseek(File, 0, SEEK_SET);
+        u32 Size = (u32)fread(Dump->Memory, 1, sizeof(Dump->Memory), File);
+        u32 PageCount = (Size + PageSize - 1) >> MEMORY_TRACKER_PAGE_SIZE_POW2;
+        for(u32 PageIndex = 0; PageIndex < PageCount; ++PageIndex)
+        {
+            Dump->PagePresent[PageIndex] = 1;
+        }
+        
+        Result = (Size != 0);
+    }
+    
+    return Result;
+}
@@ -0,0 +1,16 @@
+/* ========================================================================
+
+   sim86_memdump_read.h - Loading page dumps and raw memory dumps back in
+
+   ======================================================================== */
+
+// NOTE(agent): A dump loaded back in, either a page dump or a raw -dump file. For a raw dump, every
+// page it covers counts as present.
+struct loaded_memory_dump
+{
+    u8 Memory[1 << 20];
+    u8 PagePresent[MEMORY_TRACKER_PAGE_COUNT];
+    b32 IsPageDump;
+};
+
+static b32 LoadMemoryDump(FILE *File, loaded_memory_dump *Dump);
@@ -24,17 +24,23 @@ static u32 GetAbsoluteAddressOf(u32 Mask, u16 SegmentBase, u16 SegmentOffset, u1
 
 static u32 GetAbsoluteAddressOf(segmented_access SegMem, u16 Offset)
 {
-    u32 Result = GetAbsoluteAddressOf(SegMem.Mask, SegMem.SegmentBase, SegMem.SegmentOffset, Offset);
+    u32 Result = (SegMem.SegmentBaseAddress + (u32)(u16)(SegMem.SegmentOffset + Offset)) & SegMem.Mask;
     return Result;
 }
 
+static void SetSegmentBase(segmented_access *Access, u16 SegmentBase)
+{
+    Access->SegmentBase = SegmentBase;
+    Access->SegmentBaseAddress = (u32)SegmentBase << 4;
+}
+
 static segmented_access MoveBaseBy(segmented_access Access, s32 Offset)
 {
     Access.SegmentOffset += Offset;
     
     segmented_access Result = Access;
     
-    Result.SegmentBase += (Result.SegmentOffset >> 4);
+    SetSegmentBase(&Result, Result.SegmentBase + (Result.SegmentOffset >> 4));
     Result.SegmentOffset &= 0xf;
 
     assert(GetAbsoluteAddressOf(Result, 0) == GetAbsoluteAddressOf(Access, 0));
@@ -49,6 +55,66 @@ static u8 *AccessMemory(segmented_access SegMem, u16 Offset)
     return Result;
 }
 
+static u32 GetTrackerPageIndex(u32 AbsAddr)
+{
+    u32 Result = (AbsAddr >> MEMORY_TRACKER_PAGE_SIZE_POW2) & (MEMORY_TRACKER_PAGE_COUNT - 1);
+    return Result;
+}
+
+static void WatchMemory(memory_tracker *Tracker, u32 AbsAddr, u32 Count)
+{
+    if(Count)
+    {
+        u32 FirstPage = GetTrackerPageIndex(AbsAddr);
+        u32 LastPage = GetTrackerPageIndex(AbsAddr + Count - 1);
+        Tracker->WatchedPages[FirstPage] = 1;
+        Tracker->WatchedPages[LastPage] = 1;
+    }
+}
+
+static void NoteMemoryWrite(memory_tracker *Tracker, u32 AbsAddr)
+{
+    u32 PageIndex = GetTrackerPageIndex(AbsAddr);
+    Tracker->DirtyPages[PageIndex] = 1;
+    
+    if(Tracker->WatchedPages[PageIndex])
+    {
+        if(Tracker->WatchedPageWritten)
+        {
+            if(Tracker->WatchedWriteLow > AbsAddr) Tracker->WatchedWriteLow = AbsAddr;
+            if(Tracker->WatchedWriteHigh < AbsAddr) Tracker->WatchedWriteHigh = AbsAddr;
+        }
+        else
+        {
+            Tracker->WatchedPageWritten = true;
+            Tracker->WatchedWriteLow = AbsAddr;
+            Tracker->WatchedWriteHigh = AbsAddr;
+        }
+    }
+}
+
+// NOTE(agent): These are loops rather than memset because this file is also built into the shared
+// library, which does not link the C runtime.
+static void ClearWatchedMemory(memory_tracker *Tracker)
+{
+    for(u32 PageIndex = 0; PageIndex < MEMORY_TRACKER_PAGE_COUNT; ++PageIndex)
+    {
+        Tracker->WatchedPages[PageIndex] = 0;
+    }
+    Tracker->WatchedPageWritten = false;
+    Tracker->WatchedWriteLow = 0;
+    Tracker->WatchedWriteHigh = 0;
+}
+
+static void ClearMemoryTracker(memory_tracker *Tracker)
+{
+    ClearWatchedMemory(Tracker);
+    for(u32 PageIndex = 0; PageIndex < MEMORY_TRACKER_PAGE_COUNT; ++PageIndex)
+    {
+        Tracker->DirtyPages[PageIndex] = 0;
+    }
+}
+
 static b32 IsValid(segmented_access SegMem)
 {
     b32 Result = (SegMem.Mask != 0);
@@ -10,19 +10,49 @@
    
    ======================================================================== */
 
+// NOTE(agent): Memory is tracked in 256-byte pages, which is small enough that a write to data
+// rarely lands on the same page as code, but large enough that the page map for all 1mb of 8086
+// memory is only 4k.
+#define MEMORY_TRACKER_PAGE_SIZE_POW2 8
+#define MEMORY_TRACKER_PAGE_COUNT ((1 << 20) >> MEMORY_TRACKER_PAGE_SIZE_POW2)
+
+struct memory_tracker
+{
+    // NOTE(agent): Pages marked here are "watched" - any write to them is recorded as
+    // a range of addresses so the owner of the watch can react to it afterwards.
+    u8 WatchedPages[MEMORY_TRACKER_PAGE_COUNT];
+    
+    b32 WatchedPageWritten;
+    u32 WatchedWriteLow;
+    u32 WatchedWriteHigh;
+    
+    // NOTE(agent): Every page written since the tracker was last cleared, watched or not. This is
+    // what lets a memory dump include only the pages a run actually changed.
+    u8 DirtyPages[MEMORY_TRACKER_PAGE_COUNT];
+};
+
 struct segmented_access
 {
     u8 *Memory;
     u32 Mask;
-    u16 SegmentBase;
+    u16 SegmentBase; // NOTE(agent): Always set with SetSegmentBase, so SegmentBaseAddress stays in sync
     u16 SegmentOffset;
+    u32 SegmentBaseAddress; // NOTE(agent): SegmentBase << 4, so it is not recomputed on every access
+    
+    memory_tracker *Tracker; // NOTE(agent): Optional - only set for accesses that go to main memory
 };
 
 static u32 GetHighestAddress(segmented_access SegMem);
 static u32 GetAbsoluteAddressOf(segmented_access SegMem, u16 Offset = 0);
 static segmented_access MoveBaseBy(segmented_access Access, s32 Offset);
+static void SetSegmentBase(segmented_access *Access, u16 SegmentBase);
 
 static u8 *AccessMemory(segmented_access SegMem, u16 Offset = 0);
 
+static void WatchMemory(memory_tracker *Tracker, u32 AbsAddr, u32 Count);
+static void NoteMemoryWrite(memory_tracker *Tracker, u32 AbsAddr);
+static void ClearWatchedMemory(memory_tracker *Tracker);
+static void ClearMemoryTracker(memory_tracker *Tracker);
+
 static b32 IsValid(segmented_access SegMem);
 static segmented_access FixedMemoryPow2(u32 SizePow2, u8 *Memory);
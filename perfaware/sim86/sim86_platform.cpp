@@ -0,0 +1,210 @@
+/* ========================================================================
+
+   sim86_platform.cpp - OS timers and threads for the Windows and POSIX builds
+
+   ======================================================================== */
+
+#if _WIN32
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+static u64 GetOSTimerFreq(void)
+{
+    LARGE_INTEGER Freq;
+    QueryPerformanceFrequency(&Freq);
+    return Freq.QuadPart;
+}
+
+static u64 ReadOSTimer(void)
+{
+    LARGE_INTEGER Value;
+    QueryPerformanceCounter(&Value);
+    return Value.QuadPart;
+}
+
+static u32 GetLogicalProcessorCount(void)
+{
+    SYSTEM_INFO Info;
+    GetSystemInfo(&Info);
+    return Info.dwNumberOfProcessors;
+}
+
+static DWORD WINAPI Win32ThreadEntry(LPVOID Param)
+{
+    os_thread *Thread = (os_thread *)Param;
+    Thread->Proc(Thread->Param);
+    return 0;
+}
+
+static b32 StartThread(os_thread *Thread, thread_proc *Proc, void *Param)
+{
+    Thread->Proc = Proc;
+    Thread->Param = Param;
+    
+    HANDLE Handle = CreateThread(0, 0, Win32ThreadEntry, Thread, 0, 0);
+    Thread->Handle = (u64)Handle;
+    
+    b32 Result = (Handle != 0);
+    return Result;
+}
+
+static void WaitForThread(os_thread *Thread)
+{
+    HANDLE Handle = (HANDLE)Thread->Handle;
+    WaitForSingleObject(Handle, INFINITE);
+    CloseHandle(Handle);
+}
+
+static u32 AtomicIncrementU32(u32 volatile *Value)
+{
+    return (u32)InterlockedIncrement((LONG volatile *)Value);
+}
+
+static b32 MapFileForReading(os_mapped_file *File, char const *FileName)
+{
+    *File = {};
+    
+    HANDLE FileHandle = CreateFileA(FileName, GENERIC_READ, FILE_SHARE_READ, 0, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, 0);
+    if(FileHandle != INVALID_HANDLE_VALUE)
+    {
+        LARGE_INTEGER Size;
+        if(GetFileSizeEx(FileHandle, &Size) && Size.QuadPart)
+        {
+            HANDLE MappingHandle = CreateFileMappingA(FileHandle, 0, PAGE_READONLY, 0, 0, 0);
+            if(MappingHandle)
+            {
+                File->Data = (u8 *)MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0);
+                if(File->Data)
+                {
+                    File->Size = Size.QuadPart;
+                    File->MappingHandle = (u64)MappingHandle;
+                }
+                else
+                {
+                    CloseHandle(MappingHandle);
+                }
+            }
+        }
+        
+        if(File->Data)
+        {
+            File->FileHandle = (u64)FileHandle;
+        }
+        else
+        {
+            CloseHandle(FileHandle);
+        }
+    }
+    
+    b32 Result = (File->Data != 0);
+    return Result;
+}
+
+static void UnmapFile(os_mapped_file *File)
+{
+    if(File->Data)
+    {
+        UnmapViewOfFile(File->Data);
+        CloseHandle((HANDLE)File->MappingHandle);
+        CloseHandle((HANDLE)File->FileHandle);
+    }
+    
+    *File = {};
+}
+
+#else
+
+#include <sys/time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+static u64 GetOSTimerFreq(void)
+{
+    return 1000000;
+}
+
+static u64 ReadOSTimer(void)
+{
+    struct timeval Value;
+    gettimeofday(&Value, 0);
+    
+    u64 Result = GetOSTimerFreq()*(u64)Value.tv_sec + (u64)Value.tv_usec;
+    return Result;
+}
+
+static u32 GetLogicalProcessorCount(void)
+{
+    long Count = sysconf(_SC_NPROCESSORS_ONLN);
+    return (Count > 0) ? (u32)Count : 1;
+}
+
+static void *PosixThreadEntry(void *Param)
+{
+    os_thread *Thread = (os_thread *)Param;
+    Thread->Proc(Thread->Param);
+    return 0;
+}
+
+static b32 StartThread(os_thread *Thread, thread_proc *Proc, void *Param)
+{
+    Thread->Proc = Proc;
+    Thread->Param = Param;
+    
+    pthread_t Handle;
+    b32 Result = (pthread_create(&Handle, 0, PosixThreadEntry, Thread) == 0);
+    Thread->Handle = (u64)Handle;
+    
+    return Result;
+}
+
+static void WaitForThread(os_thread *Thread)
+{
+    pthread_join((pthread_t)Thread->Handle, 0);
+}
+
+static u32 AtomicIncrementU32(u32 volatile *Value)
+{
+    return __atomic_add_fetch(Value, 1, __ATOMIC_SEQ_CST);
+}
+
+static b32 MapFileForReading(os_mapped_file *File, char const *FileName)
+{
+    *File = {};
+    
+    int FileHandle = open(FileName, O_RDONLY);
+    if(FileHandle >= 0)
+    {
+        struct stat Stat;
+        if((fstat(FileHandle, &Stat) == 0) && Stat.st_size)
+        {
+            void *Data = mmap(0, Stat.st_size, PROT_READ, MAP_PRIVATE, FileHandle, 0);
+            if(Data != MAP_FAILED)
+            {
+                File->Data = (u8 *)Data;
+                File->Size = Stat.st_size;
+            }
+        }
+        
+        // NOTE(agent): The mapping stays valid after the descriptor is closed.
+        close(FileHandle);
+    }
+    
+    b32 Result = (File->Data != 0);
+    return Result;
+}
+
+static void UnmapFile(os_mapped_file *File)
+{
+    if(File->Data)
+    {
+        munmap(File->Data, File->Size);
+    }
+    
+    *File = {};
+}
+
+#endif
@@ -0,0 +1,33 @@
+/* ========================================================================
+
+   sim86_platform.h - OS timers and threads for the Windows and POSIX builds
+
+   ======================================================================== */
+
+static u64 GetOSTimerFreq(void);
+static u64 ReadOSTimer(void);
+
+typedef void thread_proc(void *Param);
+struct os_thread
+{
+    u64 Handle;
+    thread_proc *Proc;
+    void *Param;
+};
+
+static u32 GetLogicalProcessorCount(void);
+static b32 StartThread(os_thread *Thread, thread_proc *Proc, void *Param); // NOTE(agent): Thread must stay valid until WaitForThread returns
+static void WaitForThread(os_thread *Thread);
+static u32 AtomicIncrementU32(u32 volatile *Value); // NOTE(agent): Returns the incremented value
+
+struct os_mapped_file
+{
+    u8 *Data;
+    u64 Size;
+    u64 FileHandle;
+    u64 MappingHandle;
+};
+
+// NOTE(agent): The mapping is read-only, so any number of threads can share one without copying it.
+static b32 MapFileForReading(os_mapped_file *File, char const *FileName);
+static void UnmapFile(os_mapped_file *File);
@@ -0,0 +1,251 @@
+/* ========================================================================
+
+   sim86_profile.cpp - Hot-spot profiler (-profile, -stacks)
+
+   ======================================================================== */
+
+static void ResetProfiler(profiler *Profile, u32 StartAddress)
+{
+    // NOTE(agent): The profiler is megabytes in size, so it is cleared in place rather than by
+    // assigning an empty struct, which some compilers would build on the stack first.
+    memset(Profile, 0, sizeof(*Profile));
+    
+    Profile->StartNewBlock = true;
+    Profile->StackNodeCount = 1;
+    Profile->StackNodes[0].FunctionAddress = StartAddress;
+}
+
+static void PushProfileStack(profiler *Profile, u32 FunctionAddress)
+{
+    u32 ChildIndex = 0;
+    if(!Profile->UntrackedDepth && (Profile->StackDepth < MAX_PROFILE_STACK_DEPTH))
+    {
+        profile_stack_node *Parent = Profile->StackNodes + Profile->CurrentNodeIndex;
+        for(ChildIndex = Parent->FirstChildIndex;
+            ChildIndex && (Profile->StackNodes[ChildIndex].FunctionAddress != FunctionAddress);
+            ChildIndex = Profile->StackNodes[ChildIndex].NextSiblingIndex)
+        {
+        }
+        
+        if(!ChildIndex && (Profile->StackNodeCount < MAX_PROFILE_STACK_NODES))
+        {
+            ChildIndex = Profile->StackNodeCount++;
+            profile_stack_node *Child = Profile->StackNodes + ChildIndex;
+            Child->FunctionAddress = FunctionAddress;
+            Child->ParentIndex = Profile->CurrentNodeIndex;
+            Child->NextSiblingIndex = Parent->FirstChildIndex;
+            Parent->FirstChildIndex = ChildIndex;
+        }
+    }
+    
+    if(ChildIndex)
+    {
+        Profile->CurrentNodeIndex = ChildIndex;
+        ++Profile->StackDepth;
+    }
+    else
+    {
+        // NOTE(agent): Too deep or out of nodes. The clocks stay with the deepest tracked caller,
+        // but the call still has to be counted so that its ret does not pop a real frame.
+        ++Profile->UntrackedDepth;
+    }
+}
+
+static void PopProfileStack(profiler *Profile)
+{
+    if(Profile->UntrackedDepth)
+    {
+        --Profile->UntrackedDepth;
+    }
+    else if(Profile->StackDepth)
+    {
+        --Profile->StackDepth;
+        Profile->CurrentNodeIndex = Profile->StackNodes[Profile->CurrentNodeIndex].ParentIndex;
+    }
+}
+
+static void ProfileInstruction(profiler *Profile, instruction Instruction, u32 Clocks, u32 NextAddress)
+{
+    u32 Address = Instruction.Address & (PROFILE_ADDRESS_COUNT - 1);
+    u32 SequentialAddress = (Address + Instruction.Size) & (PROFILE_ADDRESS_COUNT - 1);
+    NextAddress &= (PROFILE_ADDRESS_COUNT - 1);
+    b32 Jumped = (NextAddress != SequentialAddress);
+    
+    ++Profile->TotalInstructions;
+    Profile->TotalClocks += Clocks;
+    ++Profile->ExecCount[Address];
+    Profile->Clocks[Address] += Clocks;
+    
+    // NOTE(agent): Falling through into an address that something already jumped to also starts
+    // a new block, so a loop body is not merged with the code that leads into it. Blocks whose
+    // start is first jumped to only after they were fallen into are merged for those earlier runs.
+    if(Profile->StartNewBlock || Profile->BlockEntryCount[Address])
+    {
+        Profile->CurrentBlock = Address;
+        ++Profile->BlockEntryCount[Address];
+    }
+    Profile->BlockClocks[Profile->CurrentBlock] += Clocks;
+    Profile->StartNewBlock = (IsBlockTerminator(Instruction) || Jumped);
+    
+    // NOTE(agent): The call itself is charged to the caller and the ret to the callee, which is
+    // what a sampling profiler would see.
+    Profile->StackNodes[Profile->CurrentNodeIndex].Clocks += Clocks;
+    switch(Instruction.Op)
+    {
+        case Op_call:
+        case Op_int:
+        case Op_int3:
+        case Op_into:
+        {
+            if(Jumped)
+            {
+                PushProfileStack(Profile, NextAddress);
+            }
+        } break;
+        
+        case Op_ret:
+        case Op_retf:
+        case Op_iret:
+        {
+            PopProfileStack(Profile);
+        } break;
+        
+        default: {} break;
+    }
+}
+
+static void InsertHottest(u32 *Hottest, u32 *HottestCount, u64 *Values, u32 Address)
+{
+    u64 Value = Values[Address];
+    u32 Count = *HottestCount;
+    if(Value && ((Count < PROFILE_REPORT_COUNT) || (Value > Values[Hottest[Count - 1]])))
+    {
+        u32 Index = (Count < PROFILE_REPORT_COUNT) ? Count++ : (Count - 1);
+        while(Index && (Values[Hottest[Index - 1]] < Value))
+        {
+            Hottest[Index] = Hottest[Index - 1];
+            --Index;
+        }
+        Hottest[Index] = Address;
+        
+        *HottestCount = Count;
+    }
+}
+
+static instruction DecodeProfiledInstruction(instruction_table Table, segmented_access Memory, u32 Address)
+{
+    // NOTE(agent): The code is decoded again from memory for the report, so if the program modified
+    // itself, this shows what is there at the end of the run.
+    segmented_access At = Memory;
+    At.Mask = PROFILE_ADDRESS_COUNT - 1;
+    SetSegmentBase(&At, 0);
+    At.SegmentOffset = (u16)Address;
+    
+    instruction Result = DecodeInstruction(Table, At);
+    return Result;
+}
+
+static u32 GetProfiledBlockEnd(profiler *Profile, instruction_table Table, segmented_access Memory, u32 StartAddress)
+{
+    u32 Result = StartAddress;
+    
+    u32 Address = StartAddress;
+    for(u32 Guard = 0; Guard < PROFILE_ADDRESS_COUNT; ++Guard)
+    {
+        instruction Instruction = DecodeProfiledInstruction(Table, Memory, Address);
+        if(!Instruction.Op)
+        {
+            break;
+        }
+        
+        Result = Address;
+        Address = (Address + Instruction.Size) & (PROFILE_ADDRESS_COUNT - 1);
+        if(IsBlockTerminator(Instruction) ||
+           Profile->BlockEntryCount[Address] ||
+           !Profile->ExecCount[Address])
+        {
+            break;
+        }
+    }
+    
+    return Result;
+}
+
+static double GetProfilePercent(profiler *Profile, u64 Clocks)
+{
+    double Result = Profile->TotalClocks ? (100.0 * (double)Clocks / (double)Profile->TotalClocks) : 0.0;
+    return Result;
+}
+
+static void PrintProfile(profiler *Profile, instruction_table Table, segmented_access Memory, FILE *Dest)
+{
+    u32 HottestInstructions[PROFILE_REPORT_COUNT];
+    u32 HottestInstructionCount = 0;
+    u32 HottestBlocks[PROFILE_REPORT_COUNT];
+    u32 HottestBlockCount = 0;
+    for(u32 Address = 0; Address < PROFILE_ADDRESS_COUNT; ++Address)
+    {
+        InsertHottest(HottestInstructions, &HottestInstructionCount, Profile->Clocks, Address);
+        InsertHottest(HottestBlocks, &HottestBlockCount, Profile->BlockClocks, Address);
+    }
+    
+    fprintf(Dest, "Profile: %llu instructions, %llu clocks\n", Profile->TotalInstructions, Profile->TotalClocks);
+    
+    fprintf(Dest, "\nHottest instructions:\n");
+    fprintf(Dest, "     clocks       %%      count  address  instruction\n");
+    for(u32 HotIndex = 0; HotIndex < HottestInstructionCount; ++HotIndex)
+    {
+        u32 Address = HottestInstructions[HotIndex];
+        fprintf(Dest, "%11llu  %6.2f%%  %9llu   0x%04x  ", Profile->Clocks[Address],
+                GetProfilePercent(Profile, Profile->Clocks[Address]), Profile->ExecCount[Address], Address);
+        
+        instruction Instruction = DecodeProfiledInstruction(Table, Memory, Address);
+        if(Instruction.Op)
+        {
+            PrintInstruction(Instruction, Dest);
+        }
+        else
+        {
+            fprintf(Dest, "(unrecognized)");
+        }
+        fprintf(Dest, "\n");
+    }
+    
+    fprintf(Dest, "\nHottest blocks:\n");
+    fprintf(Dest, "     clocks       %%    entries  addresses\n");
+    for(u32 HotIndex = 0; HotIndex < HottestBlockCount; ++HotIndex)
+    {
+        u32 Address = HottestBlocks[HotIndex];
+        fprintf(Dest, "%11llu  %6.2f%%  %9llu   0x%04x-0x%04x\n", Profile->BlockClocks[Address],
+                GetProfilePercent(Profile, Profile->BlockClocks[Address]), Profile->BlockEntryCount[Address],
+                Address, GetProfiledBlockEnd(Profile, Table, Memory, Address));
+    }
+    
+    fprintf(Dest, "\n");
+}
+
+static void WriteFoldedStacks(profiler *Profile, char const *RootName, FILE *Dest)
+{
+    // NOTE(agent): Each line is the call stack from the root down, separated by semicolons, followed
+    // by the clocks spent in the innermost function itself. Functions are named by their address.
+    for(u32 NodeIndex = 0; NodeIndex < Profile->StackNodeCount; ++NodeIndex)
+    {
+        profile_stack_node *Node = Profile->StackNodes + NodeIndex;
+        if(Node->Clocks)
+        {
+            u32 Path[MAX_PROFILE_STACK_DEPTH + 1];
+            u32 PathCount = 0;
+            for(u32 PathIndex = NodeIndex; PathIndex; PathIndex = Profile->StackNodes[PathIndex].ParentIndex)
+            {
+                Path[PathCount++] = PathIndex;
+            }
+            
+            fprintf(Dest, "%s", RootName);
+            while(PathCount--)
+            {
+                fprintf(Dest, ";0x%04x", Profile->StackNodes[Path[PathCount]].FunctionAddress);
+            }
+            fprintf(Dest, " %llu\n", Node->Clocks);
+        }
+    }
+}
@@ -0,0 +1,54 @@
+/* ========================================================================
+
+   sim86_profile.h - Hot-spot profiler (-profile, -stacks)
+
+   ======================================================================== */
+
+/* NOTE(agent): The profiler adds up how many times each instruction address was executed and how
+   many clocks were estimated for it, and does the same for basic blocks (which, like in the block
+   executor, end at anything that can change cs:ip). It also keeps a tree of call stacks, following
+   call/int and ret/iret, so the clocks can be written out in the "folded stacks" format that flame
+   graph tools read.
+
+   Run8086 masks addresses to 16 bits, so one entry per 16-bit address is enough.
+*/
+
+#define PROFILE_ADDRESS_COUNT 0x10000
+#define PROFILE_REPORT_COUNT 20
+#define MAX_PROFILE_STACK_DEPTH 64
+#define MAX_PROFILE_STACK_NODES 4096
+
+struct profile_stack_node
+{
+    u32 FunctionAddress;
+    u32 ParentIndex;
+    u32 FirstChildIndex; // NOTE(agent): 0 means "none", since the root can never be a child
+    u32 NextSiblingIndex;
+    u64 Clocks;
+};
+
+struct profiler
+{
+    u64 ExecCount[PROFILE_ADDRESS_COUNT];
+    u64 Clocks[PROFILE_ADDRESS_COUNT];
+    
+    // NOTE(agent): Indexed by the address of the first instruction in the block
+    u64 BlockEntryCount[PROFILE_ADDRESS_COUNT];
+    u64 BlockClocks[PROFILE_ADDRESS_COUNT];
+    u32 CurrentBlock;
+    b32 StartNewBlock;
+    
+    u64 TotalInstructions;
+    u64 TotalClocks;
+    
+    u32 StackNodeCount;
+    u32 CurrentNodeIndex;
+    u32 StackDepth;
+    u32 UntrackedDepth; // NOTE(agent): Calls that could not get a node, so their rets must not pop one
+    profile_stack_node StackNodes[MAX_PROFILE_STACK_NODES];
+};
+
+static void ResetProfiler(profiler *Profile, u32 StartAddress);
+static void ProfileInstruction(profiler *Profile, instruction Instruction, u32 Clocks, u32 NextAddress);
+static void PrintProfile(profiler *Profile, instruction_table Table, segmented_access Memory, FILE *Dest);
+static void WriteFoldedStacks(profiler *Profile, char const *RootName, FILE *Dest);
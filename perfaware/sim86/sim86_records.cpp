@@ -0,0 +1,285 @@
+/* ========================================================================
+
+   sim86_records.cpp - JSON Lines and CSV instruction records (-json, -csv)
+
+   ======================================================================== */
+
+static void FlushRecords(record_writer *Writer)
+{
+    if(Writer->Used)
+    {
+        if(fwrite(Writer->Buffer, Writer->Used, 1, Writer->File) != 1)
+        {
+            Writer->WriteFailed = true;
+        }
+        Writer->Used = 0;
+    }
+}
+
+static char *ReserveRecord(record_writer *Writer)
+{
+    // NOTE(agent): Same as the trace writer - records are always written whole into the buffer, and
+    // the buffer only goes to the file when the next record might not fit.
+    assert(Writer->BufferSize >= MAX_RECORD_SIZE);
+    if((Writer->BufferSize - Writer->Used) < MAX_RECORD_SIZE)
+    {
+        FlushRecords(Writer);
+    }
+    
+    char *Result = Writer->Buffer + Writer->Used;
+    return Result;
+}
+
+static void CommitRecord(record_writer *Writer, char *End)
+{
+    Writer->Used = (u32)(End - Writer->Buffer);
+    assert(Writer->Used <= Writer->BufferSize);
+}
+
+// NOTE(agent): These are used instead of sprintf, since formatting is most of the cost of writing
+// records, and none of the values need anything more than this.
+static char *PutString(char *At, char const *String)
+{
+    while(*String)
+    {
+        *At++ = *String++;
+    }
+    return At;
+}
+
+static char *PutDecimal(char *At, u32 Value)
+{
+    char Digits[10];
+    u32 DigitCount = 0;
+    do
+    {
+        Digits[DigitCount++] = (char)('0' + (Value % 10));
+        Value /= 10;
+    } while(Value);
+    
+    while(DigitCount)
+    {
+        *At++ = Digits[--DigitCount];
+    }
+    return At;
+}
+
+static char *PutSignedDecimal(char *At, s32 Value, b32 ForceSign)
+{
+    if(Value < 0)
+    {
+        *At++ = '-';
+        At = PutDecimal(At, (u32)0 - (u32)Value);
+    }
+    else
+    {
+        if(ForceSign)
+        {
+            *At++ = '+';
+        }
+        At = PutDecimal(At, (u32)Value);
+    }
+    return At;
+}
+
+static char *PutOperand(char *At, instruction Instruction, instruction_operand Operand)
+{
+    // NOTE(agent): This follows PrintInstruction, except that memory operands do not get the
+    // byte/word keyword, since the width is already in the flags.
+    switch(Operand.Type)
+    {
+        case Operand_None: {} break;
+        
+        case Operand_Register:
+        {
+            At = PutString(At, GetRegName(Operand.Register));
+        } break;
+        
+        case Operand_Memory:
+        {
+            effective_address_expression Address = Operand.Address;
+            if(Address.Flags & Address_ExplicitSegment)
+            {
+                At = PutDecimal(At, Address.ExplicitSegment);
+                *At++ = ':';
+                At = PutDecimal(At, (u32)Address.Displacement);
+            }
+            else
+            {
+                if(Instruction.Flags & Inst_Segment)
+                {
+                    At = PutString(At, GetRegName({Instruction.SegmentOverride, 0, 2}));
+                    *At++ = ':';
+                }
+                
+                *At++ = '[';
+                b32 HadTerms = false;
+                for(u32 Index = 0; Index < ArrayCount(Address.Terms); ++Index)
+                {
+                    register_access Reg = Address.Terms[Index].Register;
+                    if(Reg.Index)
+                    {
+                        if(HadTerms)
+                        {
+                            *At++ = '+';
+                        }
+                        At = PutString(At, GetRegName(Reg));
+                        HadTerms = true;
+                    }
+                }
+                
+                if(!HadTerms || (Address.Displacement != 0))
+                {
+                    At = PutSignedDecimal(At, Address.Displacement, true);
+                }
+                *At++ = ']';
+            }
+        } break;
+        
+        case Operand_Immediate:
+        {
+            immediate Immediate = Operand.Immediate;
+            if(Immediate.Flags & Immediate_RelativeJumpDisplacement)
+            {
+                *At++ = '$';
+                At = PutSignedDecimal(At, Immediate.Value + (s32)Instruction.Size, true);
+            }
+            else
+            {
+                At = PutSignedDecimal(At, Immediate.Value, false);
+            }
+        } break;
+    }
+    
+    return At;
+}
+
+static record_writer BeginRecords(FILE *File, char *Buffer, u32 BufferSize, record_format Format)
+{
+    record_writer Result = {};
+    
+    Result.File = File;
+    Result.Buffer = Buffer;
+    Result.BufferSize = BufferSize;
+    Result.Format = Format;
+    
+    if(Format == RecordFormat_CSV)
+    {
+        char *At = ReserveRecord(&Result);
+        At = PutString(At, "address,size,op,mnemonic,flags,operand0,operand1,"
+                       "clocks_min,clocks_max,ea_clocks,transfers,registers\n");
+        CommitRecord(&Result, At);
+    }
+    
+    return Result;
+}
+
+static void WriteInstructionRecord(record_writer *Writer, instruction Instruction,
+                                   register_state_8086 *Old, register_state_8086 *New,
+                                   instruction_timing Timing, instruction_clock_interval Clocks)
+{
+    char *At = ReserveRecord(Writer);
+    
+    if(Writer->Format == RecordFormat_JSONLines)
+    {
+        At = PutString(At, "{\"address\":");
+        At = PutDecimal(At, Instruction.Address);
+        At = PutString(At, ",\"size\":");
+        At = PutDecimal(At, Instruction.Size);
+        At = PutString(At, ",\"op\":");
+        At = PutDecimal(At, Instruction.Op);
+        At = PutString(At, ",\"mnemonic\":\"");
+        At = PutString(At, GetMnemonic(Instruction.Op));
+        At = PutString(At, "\",\"flags\":");
+        At = PutDecimal(At, Instruction.Flags);
+        
+        At = PutString(At, ",\"operands\":[");
+        char const *Separator = "";
+        for(u32 OperandIndex = 0; OperandIndex < ArrayCount(Instruction.Operands); ++OperandIndex)
+        {
+            instruction_operand Operand = Instruction.Operands[OperandIndex];
+            if(Operand.Type != Operand_None)
+            {
+                At = PutString(At, Separator);
+                *At++ = '"';
+                At = PutOperand(At, Instruction, Operand);
+                *At++ = '"';
+                Separator = ",";
+            }
+        }
+        
+        At = PutString(At, "],\"clocks_min\":");
+        At = PutDecimal(At, Clocks.Min);
+        At = PutString(At, ",\"clocks_max\":");
+        At = PutDecimal(At, Clocks.Max);
+        At = PutString(At, ",\"ea_clocks\":");
+        At = PutDecimal(At, Timing.EAClocks);
+        At = PutString(At, ",\"transfers\":");
+        At = PutDecimal(At, Timing.Transfers);
+        
+        At = PutString(At, ",\"registers\":{");
+        Separator = "";
+        for(u32 RegIndex = 0; RegIndex < ArrayCount(Old->u16); ++RegIndex)
+        {
+            if(Old->u16[RegIndex] != New->u16[RegIndex])
+            {
+                At = PutString(At, Separator);
+                *At++ = '"';
+                At = PutString(At, GetRegName({RegIndex, 0, 2}));
+                At = PutString(At, "\":");
+                At = PutDecimal(At, New->u16[RegIndex]);
+                Separator = ",";
+            }
+        }
+        At = PutString(At, "}}\n");
+    }
+    else
+    {
+        // NOTE(agent): None of the fields can contain a comma, a quote or a newline, so nothing
+        // has to be quoted.
+        At = PutDecimal(At, Instruction.Address);
+        *At++ = ',';
+        At = PutDecimal(At, Instruction.Size);
+        *At++ = ',';
+        At = PutDecimal(At, Instruction.Op);
+        *At++ = ',';
+        At = PutString(At, GetMnemonic(Instruction.Op));
+        *At++ = ',';
+        At = PutDecimal(At, Instruction.Flags);
+        for(u32 OperandIndex = 0; OperandIndex < ArrayCount(Instruction.Operands); ++OperandIndex)
+        {
+            *At++ = ',';
+            At = PutOperand(At, Instruction, Instruction.Operands[OperandIndex]);
+        }
+        *At++ = ',';
+        At = PutDecimal(At, Clocks.Min);
+        *At++ = ',';
+        At = PutDecimal(At, Clocks.Max);
+        *At++ = ',';
+        At = PutDecimal(At, Timing.EAClocks);
+        *At++ = ',';
+        At = PutDecimal(At, Timing.Transfers);
+        *At++ = ',';
+        
+        char const *Separator = "";
+        for(u32 RegIndex = 0; RegIndex < ArrayCount(Old->u16); ++RegIndex)
+        {
+            if(Old->u16[RegIndex] != New->u16[RegIndex])
+            {
+                At = PutString(At, Separator);
+                At = PutString(At, GetRegName({RegIndex, 0, 2}));
+                *At++ = '=';
+                At = PutDecimal(At, New->u16[RegIndex]);
+                Separator = ";";
+            }
+        }
+        *At++ = '\n';
+    }
+    
+    CommitRecord(Writer, At);
+}
+
+static void EndRecords(record_writer *Writer)
+{
+    FlushRecords(Writer);
+}
@@ -0,0 +1,50 @@
+/* ========================================================================
+
+   sim86_records.h - JSON Lines and CSV instruction records (-json, -csv)
+
+   ======================================================================== */
+
+/* NOTE(agent): Records are the per-instruction output of Run8086 in a form scripts can load directly,
+   instead of having to parse the text output. There is one record per executed instruction, with
+   these fields:
+
+     address     absolute address of the instruction
+     size        instruction size in bytes
+     op          operation_type of the instruction
+     mnemonic    the mnemonic as text
+     flags       instruction_flag bits (lock, rep, segment, wide, far)
+     operand0/1  each operand as it would be written in the disassembly, without the byte/word size
+     clocks_min, clocks_max, ea_clocks, transfers
+                 the same estimate -showclocks prints, and the parts it was made from
+     registers   the registers the instruction changed, with their new values
+
+   In JSON Lines format, each record is one object, with "operands" as an array of strings and
+   "registers" as an object of name/value pairs. In CSV format, the first line names the columns,
+   and "registers" is a list of name=value pairs separated by semicolons.
+*/
+
+enum record_format
+{
+    RecordFormat_JSONLines,
+    RecordFormat_CSV,
+};
+
+// NOTE(agent): This is larger than any single record can be, so that a record never has to be split
+// across a flush.
+#define MAX_RECORD_SIZE 1024
+
+struct record_writer
+{
+    FILE *File;
+    char *Buffer;
+    u32 BufferSize;
+    u32 Used;
+    record_format Format;
+    b32 WriteFailed;
+};
+
+static record_writer BeginRecords(FILE *File, char *Buffer, u32 BufferSize, record_format Format);
+static void WriteInstructionRecord(record_writer *Writer, instruction Instruction,
+                                   register_state_8086 *Old, register_state_8086 *New,
+                                   instruction_timing Timing, instruction_clock_interval Clocks);
+static void EndRecords(record_writer *Writer);
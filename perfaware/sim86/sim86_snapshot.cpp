@@ -0,0 +1,118 @@
+/* ========================================================================
+
+   sim86_snapshot.cpp - Machine snapshots (-snapshot, -resume)
+
+   ======================================================================== */
+
+static b32 IsZeroPage(u8 *Page)
+{
+    b32 Result = true;
+    
+    u64 *Words = (u64 *)Page;
+    for(u32 WordIndex = 0; WordIndex < (SNAPSHOT_PAGE_SIZE / sizeof(u64)); ++WordIndex)
+    {
+        if(Words[WordIndex])
+        {
+            Result = false;
+            break;
+        }
+    }
+    
+    return Result;
+}
+
+static b32 WriteSnapshot(FILE *File, snapshot_state *State, segmented_access Memory)
+{
+    u32 MemoryPageCount = (GetHighestAddress(Memory) + 1) >> SNAPSHOT_PAGE_SIZE_POW2;
+    if(MemoryPageCount > SNAPSHOT_MAX_PAGE_COUNT)
+    {
+        MemoryPageCount = SNAPSHOT_MAX_PAGE_COUNT;
+    }
+    
+    u8 FirstPage[SNAPSHOT_PAGE_SIZE] = {};
+    snapshot_header *Header = (snapshot_header *)FirstPage;
+    u32 *PageIndex = (u32 *)(Header + 1);
+    
+    Header->Magic = SIM86_SNAPSHOT_MAGIC;
+    Header->Version = SIM86_SNAPSHOT_VERSION;
+    Header->ProgramSize = State->ProgramSize;
+    for(u32 RegisterIndex = 0; RegisterIndex < Register_count; ++RegisterIndex)
+    {
+        Header->Registers[RegisterIndex] = State->Registers.u16[RegisterIndex];
+    }
+    
+    Header->Assume8088 = State->Timing.Assume8088;
+    Header->AssumeBranchTaken = State->Timing.AssumeBranchTaken;
+    Header->AssumeAddressUnaligned = State->Timing.AssumeAddressUnanaligned;
+    Header->AssumeRepCount = State->Timing.AssumeRepCount;
+    Header->AssumeShiftCount = State->Timing.AssumeShiftCount;
+    
+    for(u32 Page = 0; Page < MemoryPageCount; ++Page)
+    {
+        if(!IsZeroPage(Memory.Memory + (Page << SNAPSHOT_PAGE_SIZE_POW2)))
+        {
+            PageIndex[Header->PageCount++] = Page;
+        }
+    }
+    
+    b32 Result = (fwrite(FirstPage, SNAPSHOT_PAGE_SIZE, 1, File) == 1);
+    for(u32 Index = 0; Result && (Index < Header->PageCount); ++Index)
+    {
+        Result = (fwrite(Memory.Memory + (PageIndex[Index] << SNAPSHOT_PAGE_SIZE_POW2), SNAPSHOT_PAGE_SIZE, 1, File) == 1);
+    }
+    
+    return Result;
+}
+
+static b32 RestoreSnapshot(u8 *Data, u64 Size, segmented_access Memory, snapshot_state *State)
+{
+    b32 Result = false;
+    
+    snapshot_header *Header = (snapshot_header *)Data;
+    u32 *PageIndex = (u32 *)(Header + 1);
+    u32 MemoryPageCount = (GetHighestAddress(Memory) + 1) >> SNAPSHOT_PAGE_SIZE_POW2;
+    
+    if((Size >= SNAPSHOT_PAGE_SIZE) &&
+       (Header->Magic == SIM86_SNAPSHOT_MAGIC) &&
+       (Header->Version == SIM86_SNAPSHOT_VERSION) &&
+       (Header->PageCount <= SNAPSHOT_MAX_PAGE_COUNT) &&
+       (Size >= ((u64)Header->PageCount + 1)*SNAPSHOT_PAGE_SIZE))
+    {
+        Result = true;
+        for(u32 Index = 0; Index < Header->PageCount; ++Index)
+        {
+            if(PageIndex[Index] >= MemoryPageCount)
+            {
+                Result = false;
+            }
+        }
+    }
+    
+    if(Result)
+    {
+        // NOTE(agent): Only the stored pages are copied - everything else goes back to zero, which
+        // is what it was when the snapshot was written.
+        memset(Memory.Memory, 0, GetHighestAddress(Memory) + 1);
+        u8 *Page = Data + SNAPSHOT_PAGE_SIZE;
+        for(u32 Index = 0; Index < Header->PageCount; ++Index)
+        {
+            memcpy(Memory.Memory + (PageIndex[Index] << SNAPSHOT_PAGE_SIZE_POW2), Page, SNAPSHOT_PAGE_SIZE);
+            Page += SNAPSHOT_PAGE_SIZE;
+        }
+        
+        *State = {};
+        State->ProgramSize = Header->ProgramSize;
+        for(u32 RegisterIndex = 0; RegisterIndex < Register_count; ++RegisterIndex)
+        {
+            State->Registers.u16[RegisterIndex] = Header->Registers[RegisterIndex];
+        }
+        
+        State->Timing.Assume8088 = Header->Assume8088;
+        State->Timing.AssumeBranchTaken = Header->AssumeBranchTaken;
+        State->Timing.AssumeAddressUnanaligned = Header->AssumeAddressUnaligned;
+        State->Timing.AssumeRepCount = Header->AssumeRepCount;
+        State->Timing.AssumeShiftCount = Header->AssumeShiftCount;
+    }
+    
+    return Result;
+}
@@ -0,0 +1,53 @@
+/* ========================================================================
+
+   sim86_snapshot.h - Machine snapshots (-snapshot, -resume)
+
+   ======================================================================== */
+
+/* NOTE(agent): A snapshot is the complete state of a simulated 8086 at some point in a run, so a run
+   can be picked up from there later instead of starting over from the image. The layout is:
+
+   Page 0:
+     snapshot_header, followed by u32 PageIndex[PageCount], zero-filled to SNAPSHOT_PAGE_SIZE
+   Followed by:
+     PageCount pages of SNAPSHOT_PAGE_SIZE bytes each, in PageIndex order
+
+   Memory pages that are entirely zero are not stored, since memory starts out zeroed anyway. Every
+   stored page starts on a page boundary in the file, so a restore can copy straight out of a
+   memory-mapped view of it. Values are written in host byte order, which is little-endian on
+   everything sim86 runs on.
+*/
+
+#define SIM86_SNAPSHOT_MAGIC 0x53363853 // NOTE(agent): 'S86S'
+#define SIM86_SNAPSHOT_VERSION 1
+
+#define SNAPSHOT_PAGE_SIZE_POW2 12
+#define SNAPSHOT_PAGE_SIZE (1 << SNAPSHOT_PAGE_SIZE_POW2)
+#define SNAPSHOT_MAX_PAGE_COUNT ((1 << 20) >> SNAPSHOT_PAGE_SIZE_POW2)
+
+struct snapshot_state
+{
+    u32 ProgramSize; // NOTE(agent): Execution stops when ip leaves the first ProgramSize bytes
+    register_state_8086 Registers;
+    timing_state Timing;
+};
+
+struct snapshot_header
+{
+    u32 Magic;
+    u32 Version;
+    u32 PageCount;
+    u32 ProgramSize;
+    u16 Registers[Register_count];
+    
+    u32 Assume8088;
+    u32 AssumeBranchTaken;
+    u32 AssumeAddressUnaligned;
+    u32 AssumeRepCount;
+    u32 AssumeShiftCount;
+};
+static_assert(sizeof(snapshot_header) + SNAPSHOT_MAX_PAGE_COUNT*sizeof(u32) <= SNAPSHOT_PAGE_SIZE,
+              "Snapshot header does not fit in one page");
+
+static b32 WriteSnapshot(FILE *File, snapshot_state *State, segmented_access Memory);
+static b32 RestoreSnapshot(u8 *Data, u64 Size, segmented_access Memory, snapshot_state *State);
@@ -234,3 +234,42 @@ static void ExplainTiming(instruction_timing Timing, instruction_clock_interval
         fprintf(Dest, ")");
     }
 }
+
+static void PrintAccumulatedClocks(instruction_timing Timing, instruction_clock_interval Clocks, b32 Explain,
+                                   instruction_clock_interval *Accum, FILE *Dest)
+{
+    Accum->Min += Clocks.Min;
+    Accum->Max += Clocks.Max;
+    
+    if(Accum->Min != Accum->Max)
+    {
+        fprintf(Dest, "Clocks: +[%u,%u] = [%u,%u]", Clocks.Min, Clocks.Max, Accum->Min, Accum->Max);
+    }
+    else
+    {
+        fprintf(Dest, "Clocks: +%u = %u", Clocks.Min, Accum->Min);
+    }
+    
+    if(Explain)
+    {
+        ExplainTiming(Timing, Clocks, Dest);
+    }
+}
+
+static void PrintClocksWarning(FILE *Dest)
+{
+    fprintf(Dest,
+            "\n"
+            "WARNING: Clocks reported by this utility are strictly from the 8086 manual.\n"
+            "They will be inaccurate, both because the manual clocks are estimates, and because\n"
+            "some of the entries in the manual look highly suspicious and are probably typos.\n"
+            "\n");
+}
+
+static void PrintFinalRegisters(register_state_8086 *Registers, FILE *Dest)
+{
+    fprintf(Dest, "\n");
+    fprintf(Dest, "Final registers:\n");
+    PrintRegisters(Registers, Dest);
+    fprintf(Dest, "\n");
+}
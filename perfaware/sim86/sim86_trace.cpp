@@ -0,0 +1,177 @@
+/* ========================================================================
+
+   sim86_trace.cpp - Binary execution traces (-trace)
+
+   ======================================================================== */
+
+static void FlushTrace(trace_writer *Trace)
+{
+    if(Trace->Used)
+    {
+        if(fwrite(Trace->Buffer, Trace->Used, 1, Trace->File) != 1)
+        {
+            Trace->WriteFailed = true;
+        }
+        Trace->Used = 0;
+    }
+}
+
+static u8 *ReserveTraceRecord(trace_writer *Trace)
+{
+    // NOTE(agent): Records are always written whole into the buffer, and the buffer is only
+    // written to the file when the next record might not fit, so the file sees a few big writes.
+    assert(Trace->BufferSize >= MAX_TRACE_RECORD_SIZE);
+    if((Trace->BufferSize - Trace->Used) < MAX_TRACE_RECORD_SIZE)
+    {
+        FlushTrace(Trace);
+    }
+    
+    u8 *Result = Trace->Buffer + Trace->Used;
+    return Result;
+}
+
+static void CommitTraceRecord(trace_writer *Trace, u8 *End)
+{
+    Trace->Used = (u32)(End - Trace->Buffer);
+    assert(Trace->Used <= Trace->BufferSize);
+}
+
+static u8 *PutU8(u8 *At, u8 Value)
+{
+    *At++ = Value;
+    return At;
+}
+
+static u8 *PutU16(u8 *At, u16 Value)
+{
+    *At++ = (u8)(Value & 0xff);
+    *At++ = (u8)(Value >> 8);
+    return At;
+}
+
+static u8 *PutU32(u8 *At, u32 Value)
+{
+    At = PutU16(At, (u16)(Value & 0xffff));
+    At = PutU16(At, (u16)(Value >> 16));
+    return At;
+}
+
+static u8 *PutRegisters(u8 *At, register_state_8086 *Registers)
+{
+    for(u32 RegIndex = 0; RegIndex < ArrayCount(Registers->u16); ++RegIndex)
+    {
+        At = PutU16(At, Registers->u16[RegIndex]);
+    }
+    
+    return At;
+}
+
+static trace_writer BeginTrace(FILE *File, u8 *Buffer, u32 BufferSize, u32 TraceFlags, char const *Name)
+{
+    trace_writer Result = {};
+    
+    Result.File = File;
+    Result.Buffer = Buffer;
+    Result.BufferSize = BufferSize;
+    Result.TraceFlags = TraceFlags;
+    
+    u32 NameLength = (u32)strlen(Name);
+    if(NameLength > (MAX_TRACE_RECORD_SIZE - 64))
+    {
+        NameLength = MAX_TRACE_RECORD_SIZE - 64;
+    }
+    
+    u8 *At = ReserveTraceRecord(&Result);
+    At = PutU32(At, SIM86_TRACE_MAGIC);
+    At = PutU32(At, SIM86_TRACE_VERSION);
+    At = PutU32(At, TraceFlags);
+    At = PutU16(At, (u16)NameLength);
+    for(u32 CharIndex = 0; CharIndex < NameLength; ++CharIndex)
+    {
+        At = PutU8(At, (u8)Name[CharIndex]);
+    }
+    CommitTraceRecord(&Result, At);
+    
+    return Result;
+}
+
+static void TraceInstruction(trace_writer *Trace, u8 *Bytes, instruction Instruction,
+                             register_state_8086 *Old, register_state_8086 *New,
+                             instruction_timing Timing, instruction_clock_interval Clocks)
+{
+    u8 *At = ReserveTraceRecord(Trace);
+    
+    At = PutU8(At, TraceRecord_Instruction);
+    At = PutU8(At, (u8)Instruction.Size);
+    for(u32 ByteIndex = 0; ByteIndex < Instruction.Size; ++ByteIndex)
+    {
+        At = PutU8(At, Bytes[ByteIndex]);
+    }
+    At = PutU16(At, (u16)Instruction.Op);
+    
+    u16 ChangedMask = 0;
+    for(u32 RegIndex = 0; RegIndex < ArrayCount(Old->u16); ++RegIndex)
+    {
+        if(Old->u16[RegIndex] != New->u16[RegIndex])
+        {
+            ChangedMask |= (1 << RegIndex);
+        }
+    }
+    
+    At = PutU16(At, ChangedMask);
+    for(u32 RegIndex = 0; RegIndex < ArrayCount(New->u16); ++RegIndex)
+    {
+        if(ChangedMask & (1 << RegIndex))
+        {
+            At = PutU16(At, New->u16[RegIndex]);
+        }
+    }
+    
+    if(Trace->TraceFlags & TraceFlag_ShowClocks)
+    {
+        At = PutU32(At, Clocks.Min);
+        At = PutU32(At, Clocks.Max);
+    }
+    
+    if(Trace->TraceFlags & TraceFlag_ExplainClocks)
+    {
+        At = PutU32(At, Timing.Base.Min);
+        At = PutU32(At, Timing.Base.Max);
+        At = PutU32(At, Timing.EAClocks);
+    }
+    
+    CommitTraceRecord(Trace, At);
+}
+
+static void TraceStopOnRet(trace_writer *Trace, u32 Address)
+{
+    u8 *At = ReserveTraceRecord(Trace);
+    At = PutU8(At, TraceRecord_StopOnRet);
+    At = PutU32(At, Address);
+    CommitTraceRecord(Trace, At);
+}
+
+static void TraceUnimplemented(trace_writer *Trace, operation_type Op)
+{
+    u8 *At = ReserveTraceRecord(Trace);
+    At = PutU8(At, TraceRecord_Unimplemented);
+    At = PutU16(At, (u16)Op);
+    CommitTraceRecord(Trace, At);
+}
+
+static void TraceRegisters(trace_writer *Trace, register_state_8086 *Registers)
+{
+    u8 *At = ReserveTraceRecord(Trace);
+    At = PutU8(At, TraceRecord_Registers);
+    At = PutRegisters(At, Registers);
+    CommitTraceRecord(Trace, At);
+}
+
+static void EndTrace(trace_writer *Trace)
+{
+    u8 *At = ReserveTraceRecord(Trace);
+    At = PutU8(At, TraceRecord_End);
+    CommitTraceRecord(Trace, At);
+    
+    FlushTrace(Trace);
+}
@@ -0,0 +1,67 @@
+/* ========================================================================
+
+   sim86_trace.h - Binary execution traces (-trace)
+
+   ======================================================================== */
+
+/* NOTE(agent): A trace is a compact binary record of an execution run, which can be rendered back
+   into exactly the text Run8086 would have printed (see sim86_tracetext.cpp). All values are
+   little-endian and unaligned. The layout is:
+
+   Header:
+     u32 Magic ('S86T'), u32 Version, u32 TraceFlags
+     u16 NameLength, u8 Name[NameLength]
+
+   Followed by records, each starting with a u8 trace_record_type:
+     Instruction: u8 Size, u8 Bytes[Size], u16 Op, u16 ChangedRegisterMask, u16 NewValue for each bit set,
+                  then u32 ClocksMin, u32 ClocksMax if TraceFlag_ShowClocks,
+                  then u32 BaseMin, u32 BaseMax, u32 EAClocks if TraceFlag_ExplainClocks
+     StopOnRet: u32 Address
+     Unimplemented: u16 Op
+     Registers: u16 Registers[Register_count] (the full register state, written at the start and end of a run)
+     End: (nothing)
+*/
+
+#define SIM86_TRACE_MAGIC 0x54363853 // NOTE(agent): 'S86T'
+#define SIM86_TRACE_VERSION 1
+
+enum trace_flag
+{
+    TraceFlag_ShowClocks = 0x1,
+    TraceFlag_ExplainClocks = 0x2,
+    TraceFlag_NoRegisterDiffs = 0x4,
+};
+
+enum trace_record_type : u8
+{
+    TraceRecord_None,
+    
+    TraceRecord_Instruction,
+    TraceRecord_StopOnRet,
+    TraceRecord_Unimplemented,
+    TraceRecord_Registers,
+    TraceRecord_End,
+};
+
+// NOTE(agent): This is larger than any single record can be, so that a record never has to be split
+// across a flush.
+#define MAX_TRACE_RECORD_SIZE 256
+
+struct trace_writer
+{
+    FILE *File;
+    u8 *Buffer;
+    u32 BufferSize;
+    u32 Used;
+    u32 TraceFlags;
+    b32 WriteFailed;
+};
+
+static trace_writer BeginTrace(FILE *File, u8 *Buffer, u32 BufferSize, u32 TraceFlags, char const *Name);
+static void TraceInstruction(trace_writer *Trace, u8 *Bytes, instruction Instruction,
+                             register_state_8086 *Old, register_state_8086 *New,
+                             instruction_timing Timing, instruction_clock_interval Clocks);
+static void TraceStopOnRet(trace_writer *Trace, u32 Address);
+static void TraceUnimplemented(trace_writer *Trace, operation_type Op);
+static void TraceRegisters(trace_writer *Trace, register_state_8086 *Registers);
+static void EndTrace(trace_writer *Trace);
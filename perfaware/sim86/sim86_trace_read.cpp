@@ -0,0 +1,109 @@
+/* ========================================================================
+
+   sim86_trace_read.cpp - Reading binary execution traces back in
+
+   ======================================================================== */
+
+static void RefillTrace(trace_reader *Reader)
+{
+    u32 Remaining = Reader->Used - Reader->ReadAt;
+    memmove(Reader->Buffer, Reader->Buffer + Reader->ReadAt, Remaining);
+    Reader->Used = Remaining;
+    Reader->ReadAt = 0;
+    
+    if(!Reader->AtEndOfFile)
+    {
+        u32 MaxRead = Reader->BufferSize - Reader->Used;
+        u32 BytesRead = (u32)fread(Reader->Buffer + Reader->Used, 1, MaxRead, Reader->File);
+        Reader->Used += BytesRead;
+        if(BytesRead < MaxRead)
+        {
+            Reader->AtEndOfFile = true;
+        }
+    }
+    
+    // NOTE(agent): Anything past the end of the data reads as zero, so a truncated trace shows up as
+    // a TraceRecord_None (or as a record that runs past Used) rather than as garbage.
+    memset(Reader->Buffer + Reader->Used, 0, Reader->BufferSize - Reader->Used);
+}
+
+static u8 *PeekTraceRecord(trace_reader *Reader)
+{
+    if((Reader->Used - Reader->ReadAt) < MAX_TRACE_RECORD_SIZE)
+    {
+        RefillTrace(Reader);
+    }
+    
+    u8 *Result = Reader->Buffer + Reader->ReadAt;
+    return Result;
+}
+
+static b32 ConsumeTraceRecord(trace_reader *Reader, u8 *End)
+{
+    u32 NewReadAt = (u32)(End - Reader->Buffer);
+    b32 Result = (NewReadAt <= Reader->Used);
+    Reader->ReadAt = Result ? NewReadAt : Reader->Used;
+    
+    return Result;
+}
+
+static u8 GetU8(u8 **At)
+{
+    u8 Result = **At;
+    ++*At;
+    return Result;
+}
+
+static u16 GetU16(u8 **At)
+{
+    u16 Result = GetU8(At);
+    Result |= (u16)(GetU8(At) << 8);
+    return Result;
+}
+
+static u32 GetU32(u8 **At)
+{
+    u32 Result = GetU16(At);
+    Result |= ((u32)GetU16(At) << 16);
+    return Result;
+}
+
+static void GetRegisters(u8 **At, register_state_8086 *Registers)
+{
+    for(u32 RegIndex = 0; RegIndex < ArrayCount(Registers->u16); ++RegIndex)
+    {
+        Registers->u16[RegIndex] = GetU16(At);
+    }
+}
+
+static trace_reader BeginTraceRead(FILE *File, u8 *Buffer, u32 BufferSize, trace_header *Header)
+{
+    trace_reader Result = {};
+    
+    Result.File = File;
+    Result.Buffer = Buffer;
+    Result.BufferSize = BufferSize;
+    
+    *Header = {};
+    
+    assert(BufferSize >= (2*MAX_TRACE_RECORD_SIZE));
+    u8 *At = PeekTraceRecord(&Result);
+    u32 Magic = GetU32(&At);
+    u32 Version = GetU32(&At);
+    Header->TraceFlags = GetU32(&At);
+    u32 NameLength = GetU16(&At);
+    if((Magic == SIM86_TRACE_MAGIC) &&
+       (Version == SIM86_TRACE_VERSION) &&
+       (NameLength < ArrayCount(Header->Name)))
+    {
+        for(u32 CharIndex = 0; CharIndex < NameLength; ++CharIndex)
+        {
+            Header->Name[CharIndex] = (char)GetU8(&At);
+        }
+        Header->Name[NameLength] = 0;
+        
+        Header->Valid = ConsumeTraceRecord(&Result, At);
+    }
+    
+    return Result;
+}
@@ -0,0 +1,30 @@
+/* ========================================================================
+
+   sim86_trace_read.h - Reading binary execution traces back in (see sim86_trace.h for the format)
+
+   ======================================================================== */
+
+struct trace_reader
+{
+    FILE *File;
+    u8 *Buffer;
+    u32 BufferSize;
+    u32 Used;
+    u32 ReadAt;
+    b32 AtEndOfFile;
+};
+
+struct trace_header
+{
+    u32 TraceFlags;
+    char Name[MAX_TRACE_RECORD_SIZE];
+    b32 Valid;
+};
+
+static trace_reader BeginTraceRead(FILE *File, u8 *Buffer, u32 BufferSize, trace_header *Header);
+static u8 *PeekTraceRecord(trace_reader *Reader);
+static b32 ConsumeTraceRecord(trace_reader *Reader, u8 *End);
+static u8 GetU8(u8 **At);
+static u16 GetU16(u8 **At);
+static u32 GetU32(u8 **At);
+static void GetRegisters(u8 **At, register_state_8086 *Registers);
@@ -0,0 +1,209 @@
+/* ========================================================================
+
+   sim86_tracetext.cpp - Renders binary execution traces back into sim86 -exec text
+
+   ======================================================================== */
+
+/* NOTE(agent): sim86_tracetext renders trace files written by "sim86 -trace" back into exactly the
+   text that "sim86 -exec" would have printed for the same run (with the same -showclocks,
+   -explainclocks, etc.). The instruction bytes are stored in the trace, so each instruction is
+   simply decoded again here for printing.
+*/
+
+#include "sim86.h"
+
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "sim86_instruction.h"
+#include "sim86_instruction_table.h"
+#include "sim86_memory.h"
+#include "sim86_decode.h"
+#include "sim86_execute.h"
+#include "sim86_cycles.h"
+#include "sim86_text.h"
+#include "sim86_trace.h"
+#include "sim86_trace_read.h"
+
+#include "sim86_instruction.cpp"
+#include "sim86_instruction_table.cpp"
+#include "sim86_memory.cpp"
+#include "sim86_decode.cpp"
+#include "sim86_decode_compiled.cpp"
+#include "sim86_text_table.cpp"
+#include "sim86_text.cpp"
+#include "sim86_trace_read.cpp"
+
+#define TRACE_READ_BUFFER_SIZE (4*1024*1024)
+
+static b32 RenderTrace(trace_reader *Reader, trace_header *Header, FILE *Dest)
+{
+    b32 Result = false;
+    
+    instruction_table Table = Get8086InstructionTable();
+    register_state_8086 Registers = {};
+    instruction_clock_interval TimeAccum = {};
+    
+    u32 TraceFlags = Header->TraceFlags;
+    if(TraceFlags & TraceFlag_ShowClocks)
+    {
+        PrintClocksWarning(Dest);
+    }
+    fprintf(Dest, "--- %s execution ---\n", Header->Name);
+    
+    b32 Done = false;
+    while(!Done)
+    {
+        u8 *At = PeekTraceRecord(Reader);
+        u8 Type = GetU8(&At);
+        switch(Type)
+        {
+            case TraceRecord_Instruction:
+            {
+                // NOTE(agent): Decoding from a small buffer rather than main memory is fine, since
+                // nothing about how an instruction prints depends on where it was.
+                u8 Bytes[16] = {};
+                u32 Size = GetU8(&At);
+                for(u32 ByteIndex = 0; ByteIndex < Size; ++ByteIndex)
+                {
+                    u8 Byte = GetU8(&At);
+                    if(ByteIndex < ArrayCount(Bytes))
+                    {
+                        Bytes[ByteIndex] = Byte;
+                    }
+                }
+                
+                instruction Instruction = DecodeInstruction(Table, FixedMemoryPow2(4, Bytes));
+                u32 Op = GetU16(&At);
+                if((Instruction.Op != Op) || (Instruction.Size != Size))
+                {
+                    fprintf(stderr, "ERROR: Trace instruction bytes do not decode to the recorded instruction.\n");
+                    Done = true;
+                    break;
+                }
+                
+                register_state_8086 PrevRegisters = Registers;
+                u32 ChangedMask = GetU16(&At);
+                for(u32 RegIndex = 0; RegIndex < ArrayCount(Registers.u16); ++RegIndex)
+                {
+                    if(ChangedMask & (1 << RegIndex))
+                    {
+                        Registers.u16[RegIndex] = GetU16(&At);
+                    }
+                }
+                
+                PrintInstruction(Instruction, Dest);
+                fprintf(Dest, " ; ");
+                if(TraceFlags & TraceFlag_ShowClocks)
+                {
+                    instruction_clock_interval Clocks = {};
+                    Clocks.Min = GetU32(&At);
+                    Clocks.Max = GetU32(&At);
+                    
+                    instruction_timing Timing = {};
+                    if(TraceFlags & TraceFlag_ExplainClocks)
+                    {
+                        Timing.Base.Min = GetU32(&At);
+                        Timing.Base.Max = GetU32(&At);
+                        Timing.EAClocks = GetU32(&At);
+                    }
+                    
+                    PrintAccumulatedClocks(Timing, Clocks, (TraceFlags & TraceFlag_ExplainClocks), &TimeAccum, Dest);
+                    fprintf(Dest, " | ");
+                }
+                if(!(TraceFlags & TraceFlag_NoRegisterDiffs))
+                {
+                    PrintRegisterDifference(&PrevRegisters, &Registers, Dest);
+                }
+                fprintf(Dest, "\n");
+            } break;
+            
+            case TraceRecord_StopOnRet:
+            {
+                fprintf(Dest, "STOPONRET: Return encountered at address %u.\n", GetU32(&At));
+            } break;
+            
+            case TraceRecord_Unimplemented:
+            {
+                fprintf(Dest, "ERROR: Unimplemented instruction (%s).\n", GetMnemonic((operation_type)GetU16(&At)));
+            } break;
+            
+            case TraceRecord_Registers:
+            {
+                GetRegisters(&At, &Registers);
+            } break;
+            
+            case TraceRecord_End:
+            {
+                PrintFinalRegisters(&Registers, Dest);
+                Result = true;
+                Done = true;
+            } break;
+            
+            default:
+            {
+                Done = true;
+            } break;
+        }
+        
+        if(!ConsumeTraceRecord(Reader, At))
+        {
+            Result = false;
+            Done = true;
+        }
+    }
+    
+    return Result;
+}
+
+int main(int ArgCount, char **Args)
+{
+    if(ArgCount > 1)
+    {
+        u8 *Buffer = (u8 *)malloc(TRACE_READ_BUFFER_SIZE);
+        if(Buffer)
+        {
+            for(int ArgIndex = 1; ArgIndex < ArgCount; ++ArgIndex)
+            {
+                char *FileName = Args[ArgIndex];
+                FILE *File = fopen(FileName, "rb");
+                if(File)
+                {
+                    trace_header Header;
+                    trace_reader Reader = BeginTraceRead(File, Buffer, TRACE_READ_BUFFER_SIZE, &Header);
+                    if(Header.Valid)
+                    {
+                        if(!RenderTrace(&Reader, &Header, stdout))
+                        {
+                            fprintf(stderr, "ERROR: %s is truncated or corrupt.\n", FileName);
+                        }
+                    }
+                    else
+                    {
+                        fprintf(stderr, "ERROR: %s is not a sim86 trace.\n", FileName);
+                    }
+                    
+                    fclose(File);
+                }
+                else
+                {
+                    fprintf(stderr, "ERROR: Unable to open %s.\n", FileName);
+                }
+            }
+        }
+        else
+        {
+            fprintf(stderr, "ERROR: Unable to allocate trace buffer.\n");
+        }
+    }
+    else
+    {
+        fprintf(stderr, "USAGE: %s [sim86 trace file] ...\n", Args[0]);
+    }
+    
+    return 0;
+}